@@ -1,4 +1,6 @@
 #include "HeaderIntrospectionStage.h"
+#include "JobSystem/Parallel.h"
+#include "Utils/Core.h"
 #include "Utils/Exception.h"
 #include "Utils/Log.h"
 
@@ -9,29 +11,232 @@
 #include <clang/Serialization/ASTReader.h>
 #include <clang/Tooling/CommonOptionsParser.h>
 #include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
 #include <llvm/Support/CommandLine.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/VirtualFileSystem.h>
 
-#include <fstream>
+#include <cctype>
+
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <span>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace ClangIntrospection
 {
-	void                         IntrospectMacro(const std::vector<std::string>& args, SDKInfo::Header* headerInfo, clang::MacroInfo* macro, std::string replacementString, std::string name, bool hasUnresolvedIdentifiers);
-	std::string                  GetMacroReplacementStringAndRequirements(clang::Preprocessor& pp, clang::SourceManager& sourceManager, clang::MacroInfo* macro, std::vector<std::string>& args, bool& hasUnresolvedIdentifiers);
-	const clang::IdentifierInfo* FindMacroDefinition(clang::Preprocessor& pp, std::string_view macroName);
+	struct MacroWork
+	{
+	public:
+		clang::MacroInfo*        macroInfo;
+		SDKInfo::Header*         headerInfo;
+		std::string              name;
+		std::string              replacementString;
+		std::vector<std::string> args;
+		bool                     unresolvedIdentifiers;
+		bool                     evaluated;
+		SDKInfo::Header          result;
+	};
+
+	// Object like macros are evaluated in translation units of up to this many constants, batches of a header run in parallel
+	static constexpr std::size_t      c_MacroBatchSize     = 256;
+	static constexpr std::string_view c_MacroBatchVariable = "DX12SpecRegenMacro";
+
+	void IntrospectMacro(const std::vector<std::string>& args, SDKInfo::Header* headerInfo, clang::MacroInfo* macro, std::string replacementString, std::string name, bool hasUnresolvedIdentifiers);
+	void ApplyProfile(clang::CompilerInstance& compiler, EIntrospectionProfile profile);
+	void IntrospectMacroBatch(std::span<MacroWork* const> works);
+	bool AssignConstantValue(SDKInfo::Constant& constant, const clang::APValue& value, std::string_view headerName);
+
+	// Finds the header a declaration or macro was written in, nullptr for anything outside of the introspected headers
+	class HeaderRouter
+	{
+	public:
+		HeaderRouter(clang::SourceManager* sourceManager)
+		    : m_SourceManager(sourceManager) {}
+
+		void add(const clang::FileEntry* file, SDKInfo::Header* headerInfo)
+		{
+			if (file)
+				m_Headers[file] = headerInfo;
+		}
+
+		SDKInfo::Header* find(clang::SourceLocation location)
+		{
+			clang::FileID fileID = m_SourceManager->getFileID(m_SourceManager->getFileLoc(location));
+			// Declarations come in file order, so the previous lookup almost always answers the next one
+			if (fileID == m_LastFileID)
+				return m_LastHeader;
+
+			m_LastFileID = fileID;
+			m_LastHeader = m_Headers.lookup(m_SourceManager->getFileEntryForID(fileID));
+			return m_LastHeader;
+		}
+
+	private:
+		clang::SourceManager*                                     m_SourceManager;
+		llvm::DenseMap<const clang::FileEntry*, SDKInfo::Header*> m_Headers;
+
+		clang::FileID    m_LastFileID;
+		SDKInfo::Header* m_LastHeader = nullptr;
+	};
+
+	// Finds macros by name and remembers what every macro needs defined, so each macro's requirements are only expanded once per preprocessor
+	// Neither is thread safe, just like the preprocessor it reads from
+	class MacroIndex
+	{
+	public:
+		struct Requirements
+		{
+		public:
+			std::string              replacementString;
+			std::vector<std::string> args;
+			bool                     unresolvedIdentifiers = false;
+			bool                     expanded              = false;
+		};
+
+	public:
+		MacroIndex(clang::Preprocessor* preprocessor, clang::SourceManager* sourceManager)
+		    : m_Preprocessor(preprocessor), m_SourceManager(sourceManager)
+		{
+			for (auto& macro : m_Preprocessor->macros())
+				m_Macros.try_emplace(macro.first->getName(), macro.first);
+		}
+
+		const clang::IdentifierInfo* find(std::string_view name) const
+		{
+			return m_Macros.lookup(name);
+		}
+
+		// The replacement string of macro and the -D arguments for every macro it refers to, directly or not
+		const Requirements& requirements(const clang::MacroInfo* macro)
+		{
+			auto [itr, inserted] = m_Requirements.try_emplace(macro);
+			auto& entry          = itr->second;
+			if (!inserted)
+				return entry;
+
+			Requirements result;
+			for (auto& token : macro->tokens())
+			{
+				auto start = m_SourceManager->getCharacterData(token.getLocation());
+				auto end   = m_SourceManager->getCharacterData(token.getEndLoc());
+
+				std::string_view str = std::string_view { start, end };
+				result.replacementString += str;
+
+				if (token.getKind() != clang::tok::TokenKind::identifier)
+					continue;
+
+				if (std::any_of(macro->param_begin(), macro->param_end(), [str](const clang::IdentifierInfo* param) { return param->getName() == str; }))
+					continue;
+
+				auto requiredMacro = find(str);
+				if (!requiredMacro)
+				{
+					result.unresolvedIdentifiers = true;
+					continue;
+				}
+
+				if (!requiredMacro->hasMacroDefinition())
+				{
+					result.args.emplace_back("-D");
+					result.args.emplace_back(str);
+					continue;
+				}
+
+				auto definition = m_Preprocessor->getMacroDefinition(requiredMacro);
+				if (!definition)
+					continue;
+
+				auto macroInfo = definition.getMacroInfo();
+				if (!macroInfo)
+					continue;
+
+				if (macroInfo->isBuiltinMacro())
+					continue;
+
+				if (macroInfo->getNumTokens() == 0)
+					continue;
+
+				// Macros referring back to one still being expanded stay undefined, the preprocessor doesn't expand them either
+				auto& required = requirements(macroInfo);
+				if (!required.expanded)
+					continue;
+
+				result.args.insert(result.args.end(), required.args.begin(), required.args.end());
+				result.unresolvedIdentifiers = result.unresolvedIdentifiers || required.unresolvedIdentifiers;
+				result.args.emplace_back("-D");
+				if (macroInfo->isFunctionLike())
+				{
+					std::string params;
+					for (auto param : macroInfo->params())
+					{
+						if (!params.empty())
+							params += ',';
+						params += param->getName();
+					}
+					result.args.emplace_back(fmt::format("{}({})={}", str, params, required.replacementString));
+				}
+				else
+				{
+					result.args.emplace_back(fmt::format("{}={}", str, required.replacementString));
+				}
+			}
+
+			// Recursion may have rehashed the map, references to its elements stay valid though
+			entry          = std::move(result);
+			entry.expanded = true;
+			return entry;
+		}
+
+	private:
+		clang::Preprocessor*  m_Preprocessor;
+		clang::SourceManager* m_SourceManager;
+
+		llvm::StringMap<const clang::IdentifierInfo*>             m_Macros;
+		std::unordered_map<const clang::MacroInfo*, Requirements> m_Requirements;
+	};
 
 	class HeaderIntrospectionASTVisitor : public clang::RecursiveASTVisitor<HeaderIntrospectionASTVisitor>
 	{
 	public:
-		HeaderIntrospectionASTVisitor(clang::FileID mainFileID, clang::SourceManager* sourceManager, SDKInfo::Header* headerInfo)
-		    : m_MainFileID(mainFileID), m_SourceManager(sourceManager), m_HeaderInfo(headerInfo) {}
+		HeaderIntrospectionASTVisitor(HeaderRouter* router)
+		    : m_Router(router) {}
 
-		bool VisitEnumDecl(clang::EnumDecl* declaration)
+		// Only looks up the header of declarations at file scope, everything declared inside of one belongs to the same header
+		// Declarations of other files are skipped whole, and a precompiled prelude isn't even loaded
+		void traverseHeaders(clang::DeclContext* context)
 		{
-			if (!declInMainFile(declaration))
-				return true;
+			for (auto decl : context->noload_decls())
+			{
+				// extern "C" and namespace blocks may wrap includes, so their contents are looked up one by one
+				if (llvm::isa<clang::LinkageSpecDecl, clang::NamespaceDecl>(decl))
+				{
+					traverseHeaders(llvm::cast<clang::DeclContext>(decl));
+					continue;
+				}
 
+				m_HeaderInfo = m_Router->find(decl->getBeginLoc());
+				if (m_HeaderInfo)
+					TraverseDecl(decl);
+			}
+		}
+
+		// Statements only hold function bodies and initializers, nothing declared in them is part of a header
+		bool TraverseStmt(clang::Stmt*, DataRecursionQueue* = nullptr)
+		{
+			return true;
+		}
+
+		bool VisitEnumDecl(clang::EnumDecl* declaration)
+		{
 			SDKInfo::Enum enumInfo {};
 			enumInfo.name = declaration->getName();
 			Assert(!enumInfo.name.empty(), "Enum name is empty!");
@@ -136,9 +341,6 @@ namespace ClangIntrospection
 
 		bool VisitCXXRecordDecl(clang::CXXRecordDecl* declaration)
 		{
-			if (!declInMainFile(declaration))
-				return true;
-
 			do {
 				if (!declaration->isCompleteDefinition())
 					break;
@@ -160,9 +362,6 @@ namespace ClangIntrospection
 
 		bool VisitFunctionDecl(clang::FunctionDecl* declaration)
 		{
-			if (!declInMainFile(declaration))
-				return true;
-
 			do {
 				if (!declaration->isGlobal())
 					break;
@@ -327,11 +526,6 @@ namespace ClangIntrospection
 			m_HeaderInfo->cInterfaces.emplace_back(std::move(cInterface));
 		}
 
-		bool declInMainFile(clang::Decl* decl)
-		{
-			return m_SourceManager->getFileID(m_SourceManager->getFileLoc(decl->getBeginLoc())) == m_MainFileID;
-		}
-
 		bool isEnumAFlags(const SDKInfo::Enum& enumInfo)
 		{
 			bool hasFlagsInName = false;
@@ -382,20 +576,19 @@ namespace ClangIntrospection
 		}
 
 	private:
-		clang::FileID         m_MainFileID;
-		clang::SourceManager* m_SourceManager;
-		SDKInfo::Header*      m_HeaderInfo;
+		HeaderRouter*    m_Router;
+		SDKInfo::Header* m_HeaderInfo = nullptr;
 	};
 
 	class HeaderIntrospectionASTConsumer : public clang::ASTConsumer
 	{
 	public:
-		HeaderIntrospectionASTConsumer(clang::FileID mainFileID, clang::SourceManager* sourceManager, SDKInfo::Header* headerInfo)
-		    : m_Visitor(mainFileID, sourceManager, headerInfo) {}
+		HeaderIntrospectionASTConsumer(HeaderRouter* router)
+		    : m_Visitor(router) {}
 
 		virtual void HandleTranslationUnit(clang::ASTContext& context) override
 		{
-			m_Visitor.TraverseDecl(context.getTranslationUnitDecl());
+			m_Visitor.traverseHeaders(context.getTranslationUnitDecl());
 		}
 
 	private:
@@ -405,24 +598,53 @@ namespace ClangIntrospection
 	class HeaderIntrospectionAction : public clang::ASTFrontendAction
 	{
 	public:
-		HeaderIntrospectionAction(SDKInfo::Header* headerInfo)
-		    : m_HeaderInfo(headerInfo) {}
+		// Without paths the main file is introspected into the only header, otherwise paths[i] is introspected into headerInfos[i]
+		HeaderIntrospectionAction(std::span<const std::filesystem::path> paths, std::span<SDKInfo::Header> headerInfos, JobSystem::JobSystem* jobSystem, JobSystem::CancellationToken token, std::vector<std::filesystem::path>* dependencies, EIntrospectionProfile profile)
+		    : m_Paths(paths), m_HeaderInfos(headerInfos), m_JobSystem(jobSystem), m_Token(std::move(token)), m_Dependencies(dependencies), m_Profile(profile) {}
+
+		virtual bool BeginInvocation(clang::CompilerInstance& compiler) override
+		{
+			ApplyProfile(compiler, m_Profile);
+			return clang::ASTFrontendAction::BeginInvocation(compiler);
+		}
 
 		virtual std::unique_ptr<clang::ASTConsumer> CreateASTConsumer(clang::CompilerInstance& compiler, llvm::StringRef inFile) override
 		{
 			auto& diagnostics = compiler.getDiagnostics();
 			diagnostics.setClient(new clang::IgnoringDiagConsumer());
 
-			return std::make_unique<HeaderIntrospectionASTConsumer>(compiler.getSourceManager().getMainFileID(), &compiler.getSourceManager(), m_HeaderInfo);
+			auto& sourceManager = compiler.getSourceManager();
+			m_Router            = std::make_unique<HeaderRouter>(&sourceManager);
+			if (m_Paths.empty())
+			{
+				m_Router->add(sourceManager.getFileEntryForID(sourceManager.getMainFileID()), &m_HeaderInfos[0]);
+			}
+			else
+			{
+				auto& fileManager = compiler.getFileManager();
+				for (std::size_t i = 0; i < m_Paths.size(); ++i)
+				{
+					auto file = fileManager.getFile(m_Paths[i].string());
+					if (file)
+						m_Router->add(*file, &m_HeaderInfos[i]);
+					else
+						Log::Error("Failed to find '{}' for introspection", m_Paths[i].string());
+				}
+			}
+
+			return std::make_unique<HeaderIntrospectionASTConsumer>(m_Router.get());
 		}
 
 		virtual void EndSourceFileAction() override
 		{
-			auto&         compiler      = getCompilerInstance();
-			auto&         preprocessor  = compiler.getPreprocessor();
-			auto&         sourceManager = compiler.getSourceManager();
-			clang::FileID mainFileID    = sourceManager.getMainFileID();
+			auto& compiler      = getCompilerInstance();
+			auto& preprocessor  = compiler.getPreprocessor();
+			auto& sourceManager = compiler.getSourceManager();
 
+			MacroIndex macroIndex { &preprocessor, &sourceManager };
+
+			// The preprocessor isn't thread safe, so gather everything first and only evaluate the macros in parallel
+			std::pmr::vector<MacroWork> works { m_JobSystem->scratch() };
 			for (auto& macro : preprocessor.macros(false))
 			{
 				if (!macro.first->hasMacroDefinition())
@@ -439,7 +661,8 @@ namespace ClangIntrospection
 				if (macroInfo->getNumTokens() == 0)
 					continue;
 
-				if (sourceManager.getFileID(macroInfo->getDefinitionLoc()) != mainFileID)
+				auto headerInfo = m_Router->find(macroInfo->getDefinitionLoc());
+				if (!headerInfo)
 					continue;
 
 				auto name = macro.first->getName();
@@ -447,39 +670,379 @@ namespace ClangIntrospection
 				if (name.startswith("__"))
 					continue;
 
-				std::vector<std::string> args;
-				args.reserve(128);
-				args.emplace_back("-std=c++20");
+				auto& work      = works.emplace_back();
+				work.macroInfo  = macroInfo;
+				work.headerInfo = headerInfo;
+				work.name       = name.str();
+
+				auto& requirements = macroIndex.requirements(macroInfo);
+				work.args.reserve(requirements.args.size() + 1);
+				work.args.emplace_back("-std=c++20");
+				work.args.insert(work.args.end(), requirements.args.begin(), requirements.args.end());
+				work.unresolvedIdentifiers = requirements.unresolvedIdentifiers;
+				work.evaluated             = false;
+				work.replacementString     = requirements.replacementString;
+				work.result.name           = headerInfo->name;
+			}
 
-				bool        unresolvedIdentifiers = false;
-				std::string replacementString     = GetMacroReplacementStringAndRequirements(preprocessor, sourceManager, macroInfo, args, unresolvedIdentifiers);
+			// Constants share a few translation units instead of building one each
+			std::pmr::vector<MacroWork*> constants { m_JobSystem->scratch() };
+			for (auto& work : works)
+				if (!work.macroInfo->isFunctionLike() && !work.unresolvedIdentifiers)
+					constants.emplace_back(&work);
+
+			JobSystem::ParallelFor(
+			    *m_JobSystem,
+			    0,
+			    (constants.size() + c_MacroBatchSize - 1) / c_MacroBatchSize,
+			    [&](std::size_t i)
+			    {
+				    if (m_Token.cancelled())
+					    return;
+
+				    std::size_t first = i * c_MacroBatchSize;
+				    IntrospectMacroBatch(std::span<MacroWork* const> { constants }.subspan(first, std::min(c_MacroBatchSize, constants.size() - first)));
+			    });
+
+			JobSystem::ParallelFor(
+			    *m_JobSystem,
+			    0,
+			    works.size(),
+			    [&](std::size_t i)
+			    {
+				    // Whatever the batches couldn't evaluate builds its own AST, don't bother once the output is lost anyway
+				    if (m_Token.cancelled())
+					    return;
+
+				    auto& work = works[i];
+				    if (work.evaluated)
+					    return;
+
+				    IntrospectMacro(work.args, &work.result, work.macroInfo, std::move(work.replacementString), std::move(work.name), work.unresolvedIdentifiers);
+			    });
+
+			for (auto& work : works)
+			{
+				for (auto& function : work.result.functions)
+					work.headerInfo->functions.emplace_back(std::move(function));
+				for (auto& constant : work.result.constants)
+					work.headerInfo->constants.emplace_back(std::move(constant));
+			}
 
-				IntrospectMacro(args, m_HeaderInfo, macroInfo, std::move(replacementString), name.data(), unresolvedIdentifiers);
+			if (m_Dependencies)
+				collectDependencies(compiler);
+		}
+
+	private:
+		// Every real file the parse read, the main file is generated from the paths and not on disk
+		void collectDependencies(clang::CompilerInstance& compiler)
+		{
+			auto&                           sourceManager = compiler.getSourceManager();
+			const clang::FileEntry*         mainFile      = sourceManager.getFileEntryForID(sourceManager.getMainFileID());
+			std::set<std::filesystem::path> dependencies;
+			for (auto itr = sourceManager.fileinfo_begin(); itr != sourceManager.fileinfo_end(); ++itr)
+				if (itr->first != mainFile)
+					dependencies.emplace(itr->first->getName().str());
+
+			// Files of the precompiled prelude only show up in the source manager once something looks at them
+			if (auto reader = compiler.getASTReader())
+			{
+				for (auto& module : reader->getModuleManager())
+				{
+					reader->visitInputFiles(
+					    module,
+					    true,
+					    false,
+					    [&](const clang::serialization::InputFile& inputFile, bool isSystem)
+					    {
+						    if (auto file = inputFile.getFile())
+							    dependencies.emplace(file->getName().str());
+					    });
+				}
 			}
+
+			m_Dependencies->assign(dependencies.begin(), dependencies.end());
+		}
+
+	private:
+		std::span<const std::filesystem::path> m_Paths;
+		std::span<SDKInfo::Header>             m_HeaderInfos;
+		std::unique_ptr<HeaderRouter>          m_Router;
+		JobSystem::JobSystem*                  m_JobSystem;
+		JobSystem::CancellationToken           m_Token;
+		std::vector<std::filesystem::path>*    m_Dependencies;
+		EIntrospectionProfile                  m_Profile;
+	};
+
+	class PrecompilePreludeAction : public clang::GeneratePCHAction
+	{
+	public:
+		// The headers reading the precompiled prelude have to use the same profile, it changes language options the PCH is checked against
+		PrecompilePreludeAction(std::string outputFile, EIntrospectionProfile profile)
+		    : m_OutputFile(std::move(outputFile)), m_Profile(profile) {}
+
+		virtual bool BeginInvocation(clang::CompilerInstance& compiler) override
+		{
+			compiler.getFrontendOpts().OutputFile = m_OutputFile;
+			ApplyProfile(compiler, m_Profile);
+			return clang::GeneratePCHAction::BeginInvocation(compiler);
 		}
 
 	private:
-		SDKInfo::Header* m_HeaderInfo;
+		std::string           m_OutputFile;
+		EIntrospectionProfile m_Profile;
 	};
 
-	bool Introspect(const std::vector<std::string>& args, std::filesystem::path path, SDKInfo::Header* headerInfo)
+	// What every MIDL generated SDK header includes before its own declarations
+	static constexpr std::string_view c_PreludeCode = "#include <rpc.h>\n"
+	                                                  "#include <rpcndr.h>\n"
+	                                                  "#include <windows.h>\n"
+	                                                  "#include <ole2.h>\n";
+
+	// Serves every file below a search directory from a single buffer per path, which llvm memory maps unless the file is small
+	// Include lookups mostly miss, every header is searched for in each include directory before the one holding it, so statuses are cached as well
+	class MappedFileSystem : public llvm::vfs::ProxyFileSystem
+	{
+	public:
+		MappedFileSystem()
+		    : llvm::vfs::ProxyFileSystem(llvm::vfs::getRealFileSystem()) {}
+
+		void addSearchDirectory(const std::filesystem::path& directory)
+		{
+			std::lock_guard lock { m_Mutex };
+			m_Directories.try_emplace(NormalizePath(directory.string()));
+		}
+
+		virtual llvm::ErrorOr<llvm::vfs::Status> status(const llvm::Twine& path) override
+		{
+			std::string pathStr = path.str();
+			bool        cache   = false;
+			{
+				std::lock_guard lock { m_Mutex };
+				auto            file = m_Files.find(pathStr);
+				if (file != m_Files.end())
+					return file->second.status;
+
+				auto itr = m_Statuses.find(pathStr);
+				if (itr != m_Statuses.end())
+					return itr->second;
+
+				auto listing = findListing(pathStr);
+				if (listing && !listing->contains(NormalizeName(llvm::sys::path::filename(pathStr))))
+					return std::make_error_code(std::errc::no_such_file_or_directory);
+				// Only what's in the search directories stays the same, temporaries like the prelude's PCH don't
+				cache = inSearchDirectory(pathStr);
+			}
+
+			auto status = llvm::vfs::ProxyFileSystem::status(path);
+			if (cache)
+			{
+				std::lock_guard lock { m_Mutex };
+				m_Statuses.try_emplace(std::move(pathStr), status);
+			}
+			return status;
+		}
+
+		virtual llvm::ErrorOr<std::unique_ptr<llvm::vfs::File>> openFileForRead(const llvm::Twine& path) override
+		{
+			std::string pathStr = path.str();
+			bool        cache   = false;
+			{
+				std::lock_guard lock { m_Mutex };
+				auto            itr = m_Files.find(pathStr);
+				if (itr != m_Files.end())
+					return std::make_unique<MappedFile>(&itr->second);
+
+				auto listing = findListing(pathStr);
+				if (listing && !listing->contains(NormalizeName(llvm::sys::path::filename(pathStr))))
+					return std::make_error_code(std::errc::no_such_file_or_directory);
+				cache = inSearchDirectory(pathStr);
+			}
+
+			// Mapping a file that changes during the run would keep serving its old contents
+			if (!cache)
+				return llvm::vfs::ProxyFileSystem::openFileForRead(path);
+
+			auto file = llvm::vfs::ProxyFileSystem::openFileForRead(path);
+			if (!file)
+				return file.getError();
+			auto status = (*file)->status();
+			if (!status)
+				return status.getError();
+			auto buffer = (*file)->getBuffer(pathStr, status->getSize(), true, false);
+			if (!buffer)
+				return buffer.getError();
+
+			// Another job may have mapped the file in the meantime, both buffers hold the same contents
+			std::lock_guard lock { m_Mutex };
+			auto [itr, inserted] = m_Files.try_emplace(std::move(pathStr), Mapping { std::move(*status), std::move(*buffer) });
+			return std::make_unique<MappedFile>(&itr->second);
+		}
+
+	private:
+		struct Mapping
+		{
+		public:
+			llvm::vfs::Status                   status;
+			std::unique_ptr<llvm::MemoryBuffer> buffer;
+		};
+
+		// Hands out views of the mapping, which lives as long as the file system
+		class MappedFile : public llvm::vfs::File
+		{
+		public:
+			MappedFile(const Mapping* mapping)
+			    : m_Mapping(mapping) {}
+
+			virtual llvm::ErrorOr<llvm::vfs::Status> status() override { return m_Mapping->status; }
+
+			virtual llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> getBuffer(const llvm::Twine& name, std::int64_t fileSize, bool requiresNullTerminator, bool isVolatile) override
+			{
+				return llvm::MemoryBuffer::getMemBuffer(m_Mapping->buffer->getBuffer(), name.str(), requiresNullTerminator);
+			}
+
+			virtual std::error_code close() override { return {}; }
+
+		private:
+			const Mapping* m_Mapping;
+		};
+
+	private:
+		// Lists the parent of path on first use if it is a search directory, nullptr if it isn't, requires m_Mutex
+		const std::unordered_set<std::string>* findListing(std::string_view path)
+		{
+			auto itr = m_Directories.find(NormalizePath(llvm::sys::path::parent_path(path)));
+			if (itr == m_Directories.end())
+				return nullptr;
+
+			if (!itr->second)
+			{
+				auto&           names = itr->second.emplace();
+				std::error_code error;
+				for (auto& entry : std::filesystem::directory_iterator { itr->first, error })
+					names.emplace(NormalizeName(entry.path().filename().string()));
+			}
+			return &*itr->second;
+		}
+
+		// Whether path lies anywhere below a search directory, requires m_Mutex
+		bool inSearchDirectory(std::string_view path) const
+		{
+			for (auto parent = llvm::sys::path::parent_path(path); !parent.empty(); parent = llvm::sys::path::parent_path(parent))
+				if (m_Directories.contains(NormalizePath(parent)))
+					return true;
+			return false;
+		}
+
+		static std::string NormalizePath(std::string_view path)
+		{
+			std::string normalized = std::filesystem::path { path }.lexically_normal().generic_string();
+			if (normalized.size() > 1 && normalized.back() == '/')
+				normalized.pop_back();
+			return NormalizeName(normalized);
+		}
+
+		static std::string NormalizeName(std::string_view name)
+		{
+			std::string normalized { name };
+#if BUILD_IS_SYSTEM_WINDOWS
+			std::transform(normalized.begin(), normalized.end(), normalized.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+#endif
+			return normalized;
+		}
+
+	private:
+		std::mutex                                                                      m_Mutex;
+		std::unordered_map<std::string, Mapping>                                        m_Files;
+		std::unordered_map<std::string, llvm::ErrorOr<llvm::vfs::Status>>               m_Statuses;
+		std::unordered_map<std::string, std::optional<std::unordered_set<std::string>>> m_Directories;
+	};
+
+	class SDKFileSystem::Impl
+	{
+	public:
+		llvm::IntrusiveRefCntPtr<MappedFileSystem> m_FileSystem = llvm::makeIntrusiveRefCnt<MappedFileSystem>();
+	};
+
+	SDKFileSystem::SDKFileSystem()
+	    : m_Impl(std::make_unique<Impl>()) {}
+
+	SDKFileSystem::SDKFileSystem(SDKFileSystem&& move) noexcept = default;
+
+	SDKFileSystem::~SDKFileSystem() = default;
+
+	SDKFileSystem& SDKFileSystem::operator=(SDKFileSystem&& move) noexcept = default;
+
+	void SDKFileSystem::addSearchDirectory(const std::filesystem::path& directory)
+	{
+		m_Impl->m_FileSystem->addSearchDirectory(directory);
+	}
+
+	static llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> GetFileSystem(SDKFileSystem* fileSystem)
+	{
+		if (fileSystem)
+			return fileSystem->impl().m_FileSystem;
+		return llvm::vfs::getRealFileSystem();
+	}
+
+	// runToolOnCodeWithArgs only maps code to filename when it creates the file system itself, code has to be null terminated
+	static llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> WithMainFile(llvm::IntrusiveRefCntPtr<llvm::vfs::FileSystem> fileSystem, llvm::StringRef filename, llvm::StringRef code)
+	{
+		llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem>  overlay  = new llvm::vfs::OverlayFileSystem(std::move(fileSystem));
+		llvm::IntrusiveRefCntPtr<llvm::vfs::InMemoryFileSystem> inMemory = new llvm::vfs::InMemoryFileSystem();
+		overlay->pushOverlay(inMemory);
+		inMemory->addFile(filename, 0, llvm::MemoryBuffer::getMemBuffer(code, filename));
+		return overlay;
+	}
+
+	bool PrecompilePrelude(const std::vector<std::string>& args, const std::filesystem::path& pchPath, SDKFileSystem* fileSystem, EIntrospectionProfile profile)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(pchPath.parent_path(), error);
+
+		std::vector<std::string> pchArgs = args;
+		pchArgs.emplace_back("-x");
+		pchArgs.emplace_back("c++-header");
+		llvm::StringRef preludeCode { c_PreludeCode.data(), c_PreludeCode.size() };
+		return clang::tooling::runToolOnCodeWithArgs(std::make_unique<PrecompilePreludeAction>(pchPath.string(), profile), preludeCode, WithMainFile(GetFileSystem(fileSystem), "prelude.h", preludeCode), pchArgs, "prelude.h", "clang-tool", std::make_shared<clang::PCHContainerOperations>());
+	}
+
+	bool Introspect(const std::vector<std::string>& args, const std::filesystem::path& path, SDKInfo::Header* headerInfo, JobSystem::JobSystem& jobSystem, JobSystem::CancellationToken token, std::vector<std::filesystem::path>* dependencies, SDKFileSystem* fileSystem, EIntrospectionProfile profile)
 	{
 		std::string filename = path.filename().replace_extension(".cpp").string();
 
-		std::string   code;
-		std::ifstream file { path, std::ios::ate };
-		if (!file)
+		auto vfs    = GetFileSystem(fileSystem);
+		auto buffer = vfs->getBufferForFile(path.string());
+		if (!buffer)
 		{
 			Log::Critical("Failed to open '{}'", path.string());
 			return false;
 		}
-		code.resize(file.tellg());
-		file.seekg(0);
-		file.read(code.data(), code.size());
-		file.close();
-		code.resize(code.find_last_not_of('\0'));
+		// Some SDK headers are padded with NULs
+		llvm::StringRef code = (*buffer)->getBuffer().rtrim('\0');
 
-		return clang::tooling::runToolOnCodeWithArgs(std::make_unique<HeaderIntrospectionAction>(headerInfo), code, args, filename, "clang-tool", std::make_shared<clang::PCHContainerOperations>());
+		bool result = clang::tooling::runToolOnCodeWithArgs(std::make_unique<HeaderIntrospectionAction>(std::span<const std::filesystem::path> {}, std::span<SDKInfo::Header> { headerInfo, 1 }, &jobSystem, token, dependencies, profile), code, WithMainFile(vfs, filename, code), args, filename, "clang-tool", std::make_shared<clang::PCHContainerOperations>());
+		// Macro evaluation stopped early, so the header misses constants
+		return result && !token.cancelled();
+	}
+
+	bool IntrospectSDK(const std::vector<std::string>& args, std::span<const std::filesystem::path> paths, std::span<SDKInfo::Header> headerInfos, JobSystem::JobSystem& jobSystem, JobSystem::CancellationToken token, std::vector<std::filesystem::path>* dependencies, SDKFileSystem* fileSystem, EIntrospectionProfile profile)
+	{
+		Assert(paths.size() == headerInfos.size(), "Every header needs a path");
+
+		// Headers are included by their real path so the file manager knows them, include guards make later headers skip the ones earlier headers already pulled in
+		std::pmr::string code { jobSystem.scratch() };
+		for (auto& path : paths)
+		{
+			code += "#include \"";
+			code += path.generic_string();
+			code += "\"\n";
+		}
+
+		llvm::StringRef codeRef { code.data(), code.size() };
+		bool            result = clang::tooling::runToolOnCodeWithArgs(std::make_unique<HeaderIntrospectionAction>(paths, headerInfos, &jobSystem, token, dependencies, profile), codeRef, WithMainFile(GetFileSystem(fileSystem), "sdk.cpp", codeRef), args, "sdk.cpp", "clang-tool", std::make_shared<clang::PCHContainerOperations>());
+		// Macro evaluation stopped early, so the headers miss constants
+		return result && !token.cancelled();
 	}
 
 	void IntrospectMacro(const std::vector<std::string>& args, SDKInfo::Header* headerInfo, clang::MacroInfo* macro, std::string replacementString, std::string name, bool hasUnresolvedIdentifiers)
@@ -512,7 +1075,8 @@ namespace ClangIntrospection
 			if (!hasUnresolvedIdentifiers)
 			{
 				constantAST = clang::tooling::buildASTFromCodeWithArgs(fmt::format("constexpr auto x = {};", replacementString), args);
-				TU          = constantAST->getASTContext().getTranslationUnitDecl();
+				if (constantAST)
+					TU = constantAST->getASTContext().getTranslationUnitDecl();
 			}
 			bool assignedConstant = false;
 			if (TU)
@@ -521,119 +1085,9 @@ namespace ClangIntrospection
 				{
 					if (decl->getKind() == clang::Decl::Kind::Var)
 					{
-						auto varDecl = static_cast<clang::VarDecl*>(decl);
-						auto value   = varDecl->evaluateValue();
-						switch (value->getKind())
-						{
-						case clang::APValue::Int:
-						{
-							auto& intValue = value->getInt();
-							if (intValue.isSigned())
-							{
-								auto bitWidth = intValue.getBitWidth();
-								constant.type = fmt::format("i{}", bitWidth);
-							}
-							else
-							{
-								auto bitWidth = intValue.getBitWidth();
-								constant.type = fmt::format("u{}", bitWidth);
-							}
-							llvm::SmallString<1024> str;
-							intValue.toString(str);
-							constant.value   = std::string_view { str.data(), str.size() };
-							assignedConstant = true;
-							break;
-						}
-						case clang::APValue::Float:
-						{
-							auto& floatValue = value->getFloat();
-							switch (llvm::APFloatBase::SemanticsToEnum(floatValue.getSemantics()))
-							{
-							case llvm::APFloatBase::Semantics::S_IEEEhalf:
-								constant.type = "f16";
-								break;
-							case llvm::APFloatBase::Semantics::S_BFloat:
-								constant.type = "f16";
-								break;
-							case llvm::APFloatBase::Semantics::S_IEEEsingle:
-								constant.type = "f32";
-								break;
-							case llvm::APFloatBase::Semantics::S_IEEEdouble:
-								constant.type = "f64";
-								break;
-							case llvm::APFloatBase::Semantics::S_IEEEquad:
-								constant.type = "f128";
-								break;
-							case llvm::APFloatBase::Semantics::S_PPCDoubleDouble:
-								constant.type = "f128";
-								break;
-							case llvm::APFloatBase::Semantics::S_Float8E5M2:
-								constant.type = "f8";
-								break;
-							case llvm::APFloatBase::Semantics::S_x87DoubleExtended:
-								constant.type = "f80";
-								break;
-							default:
-								Log::Critical("WTF unknown float type detected for macro '{}' in header '{}'!!!", constant.name, headerInfo->name);
-								break;
-							}
-							llvm::SmallString<1024> str;
-							floatValue.toString(str);
-							constant.value   = std::string_view { str.data(), str.size() };
-							assignedConstant = true;
-							break;
-						}
-						case clang::APValue::FixedPoint:
-						{
-							auto& fixedValue = value->getFixedPoint();
-							if (fixedValue.isSigned())
-							{
-								auto width      = fixedValue.getWidth();
-								auto fractional = fixedValue.getScale();
-								constant.type   = fmt::format("i{}.{}", width - fractional, fractional);
-							}
-							else
-							{
-								auto width      = fixedValue.getWidth();
-								auto fractional = fixedValue.getScale();
-								constant.type   = fmt::format("u{}.{}", width - fractional, fractional);
-							}
-
-							llvm::SmallString<1024> str;
-							fixedValue.toString(str);
-							constant.value   = std::string_view { str.data(), str.size() };
-							assignedConstant = true;
-							break;
-						}
-						case clang::APValue::ComplexInt:
-							Log::Error("ComplexInt not implemented");
-							break;
-						case clang::APValue::ComplexFloat:
-							Log::Error("ComplexFloat not implemented");
-							break;
-						case clang::APValue::LValue:
-							Log::Error("LValue not implemented");
-							break;
-						case clang::APValue::Vector:
-							Log::Error("Vector not implemented");
-							break;
-						case clang::APValue::Array:
-							Log::Error("Array not implemented");
-							break;
-						case clang::APValue::Struct:
-							Log::Error("Struct not implemented");
-							break;
-						case clang::APValue::Union:
-							Log::Error("Union not implemented");
-							break;
-						case clang::APValue::MemberPointer:
-							Log::Error("MemberPointer not implemented");
-							break;
-						case clang::APValue::AddrLabelDiff:
-							Log::Error("AddrLabelDiff not implemented");
-							break;
-						default: break;
-						}
+						auto varDecl     = static_cast<clang::VarDecl*>(decl);
+						auto value       = varDecl->evaluateValue();
+						assignedConstant = value && AssignConstantValue(constant, *value, headerInfo->name);
 						break;
 					}
 				}
@@ -647,78 +1101,186 @@ namespace ClangIntrospection
 		}
 	}
 
-	std::string GetMacroReplacementStringAndRequirements(clang::Preprocessor& pp, clang::SourceManager& sourceManager, clang::MacroInfo* macro, std::vector<std::string>& args, bool& hasUnresolvedIdentifiers)
+	void ApplyProfile(clang::CompilerInstance& compiler, EIntrospectionProfile profile)
 	{
-		std::string replacementString;
-		for (auto& token : macro->tokens())
-		{
-			auto start = sourceManager.getCharacterData(token.getLocation());
-			auto end   = sourceManager.getCharacterData(token.getEndLoc());
-
-			std::string_view str = std::string_view { start, end };
-			replacementString += str;
+		if (profile != EIntrospectionProfile::Fast)
+			return;
+
+		// The visitors only read declarations, Sema still parses the bodies of constexpr functions and deduced return types
+		// Skipping the rest also skips the templates only they instantiated
+		compiler.getFrontendOpts().SkipFunctionBodies = true;
+		// Diagnostics are thrown away anyway, ignoring warnings up front skips the checks behind them
+		compiler.getDiagnostics().setIgnoreAllWarnings(true);
+		compiler.getLangOpts().SpellChecking = false;
+	}
 
-			if (token.getKind() == clang::tok::TokenKind::identifier)
+	void IntrospectMacroBatch(std::span<MacroWork* const> works)
+	{
+		// All macros come from the same preprocessor, so a requirement shared by several of them has the same definition for each
+		std::string                     code;
+		std::unordered_set<std::string> defined;
+		for (auto work : works)
+		{
+			for (std::size_t i = 0; i + 1 < work->args.size(); ++i)
 			{
-				for (auto& param : macro->params())
-					if (param->getName().data() == str)
-						continue;
-
-				auto requiredMacro = FindMacroDefinition(pp, str);
-				if (!requiredMacro)
-				{
-					hasUnresolvedIdentifiers = hasUnresolvedIdentifiers || true;
+				if (work->args[i] != "-D")
 					continue;
-				}
 
-				if (!requiredMacro->hasMacroDefinition())
-				{
-					args.emplace_back("-D");
-					args.emplace_back(str);
+				std::string_view definition = work->args[++i];
+				if (!defined.emplace(definition).second)
 					continue;
-				}
 
-				auto definition = pp.getMacroDefinition(requiredMacro);
-				if (!definition)
-					continue;
-
-				auto macroInfo = definition.getMacroInfo();
-				if (!macroInfo)
-					continue;
-
-				if (macroInfo->isBuiltinMacro())
-					continue;
+				// Same meaning as the -D arguments IntrospectMacro passes
+				auto equals = definition.find('=');
+				if (equals == std::string_view::npos)
+					code += fmt::format("#define {} 1\n", definition);
+				else
+					code += fmt::format("#define {} {}\n", definition.substr(0, equals), definition.substr(equals + 1));
+			}
+		}
+		for (std::size_t i = 0; i < works.size(); ++i)
+			code += fmt::format("constexpr auto {}{} = {};\n", c_MacroBatchVariable, i, works[i]->replacementString);
 
-				if (macroInfo->getNumTokens() == 0)
-					continue;
+		auto batchAST = clang::tooling::buildASTFromCodeWithArgs(code, { "-std=c++20" });
+		if (!batchAST)
+			return;
 
-				std::string replacementStr = GetMacroReplacementStringAndRequirements(pp, sourceManager, macroInfo, args, hasUnresolvedIdentifiers);
-				args.emplace_back("-D");
-				if (macroInfo->isFunctionLike())
-				{
-					std::string params;
-					for (auto param : macroInfo->params())
-					{
-						if (!params.empty())
-							params += ',';
-						params += param->getName();
-					}
-					args.emplace_back(fmt::format("{}({})={}", str, params, replacementStr));
-				}
-				else
-				{
-					args.emplace_back(fmt::format("{}={}", str, replacementStr));
-				}
+		// Macros whose variable is broken or missing, possibly swallowed by a broken neighbour, are left for IntrospectMacro to retry alone
+		for (auto decl : batchAST->getASTContext().getTranslationUnitDecl()->decls())
+		{
+			auto varDecl = llvm::dyn_cast<clang::VarDecl>(decl);
+			if (!varDecl || varDecl->isInvalidDecl())
+				continue;
+
+			auto        name  = varDecl->getName();
+			std::size_t index = 0;
+			if (!name.consume_front(c_MacroBatchVariable) || name.getAsInteger(10, index) || index >= works.size())
+				continue;
+
+			auto work       = works[index];
+			work->evaluated = true;
+
+			auto& constant = work->result.constants.emplace_back();
+			constant.name  = std::move(work->name);
+			auto value     = varDecl->evaluateValue();
+			if (!value || !AssignConstantValue(constant, *value, work->result.name))
+			{
+				constant.type  = "auto";
+				constant.value = std::move(work->replacementString);
 			}
 		}
-		return replacementString;
 	}
 
-	const clang::IdentifierInfo* FindMacroDefinition(clang::Preprocessor& pp, std::string_view macroName)
+	bool AssignConstantValue(SDKInfo::Constant& constant, const clang::APValue& value, std::string_view headerName)
 	{
-		for (auto& macro : pp.macros())
-			if (macro.first->getName().data() == macroName)
-				return macro.first;
-		return nullptr;
+		switch (value.getKind())
+		{
+		case clang::APValue::Int:
+		{
+			auto& intValue = value.getInt();
+			if (intValue.isSigned())
+			{
+				auto bitWidth = intValue.getBitWidth();
+				constant.type = fmt::format("i{}", bitWidth);
+			}
+			else
+			{
+				auto bitWidth = intValue.getBitWidth();
+				constant.type = fmt::format("u{}", bitWidth);
+			}
+			llvm::SmallString<1024> str;
+			intValue.toString(str);
+			constant.value = std::string_view { str.data(), str.size() };
+			return true;
+		}
+		case clang::APValue::Float:
+		{
+			auto& floatValue = value.getFloat();
+			switch (llvm::APFloatBase::SemanticsToEnum(floatValue.getSemantics()))
+			{
+			case llvm::APFloatBase::Semantics::S_IEEEhalf:
+				constant.type = "f16";
+				break;
+			case llvm::APFloatBase::Semantics::S_BFloat:
+				constant.type = "f16";
+				break;
+			case llvm::APFloatBase::Semantics::S_IEEEsingle:
+				constant.type = "f32";
+				break;
+			case llvm::APFloatBase::Semantics::S_IEEEdouble:
+				constant.type = "f64";
+				break;
+			case llvm::APFloatBase::Semantics::S_IEEEquad:
+				constant.type = "f128";
+				break;
+			case llvm::APFloatBase::Semantics::S_PPCDoubleDouble:
+				constant.type = "f128";
+				break;
+			case llvm::APFloatBase::Semantics::S_Float8E5M2:
+				constant.type = "f8";
+				break;
+			case llvm::APFloatBase::Semantics::S_x87DoubleExtended:
+				constant.type = "f80";
+				break;
+			default:
+				Log::Critical("WTF unknown float type detected for macro '{}' in header '{}'!!!", constant.name, headerName);
+				break;
+			}
+			llvm::SmallString<1024> str;
+			floatValue.toString(str);
+			constant.value = std::string_view { str.data(), str.size() };
+			return true;
+		}
+		case clang::APValue::FixedPoint:
+		{
+			auto& fixedValue = value.getFixedPoint();
+			if (fixedValue.isSigned())
+			{
+				auto width      = fixedValue.getWidth();
+				auto fractional = fixedValue.getScale();
+				constant.type   = fmt::format("i{}.{}", width - fractional, fractional);
+			}
+			else
+			{
+				auto width      = fixedValue.getWidth();
+				auto fractional = fixedValue.getScale();
+				constant.type   = fmt::format("u{}.{}", width - fractional, fractional);
+			}
+
+			llvm::SmallString<1024> str;
+			fixedValue.toString(str);
+			constant.value = std::string_view { str.data(), str.size() };
+			return true;
+		}
+		case clang::APValue::ComplexInt:
+			Log::Error("ComplexInt not implemented");
+			break;
+		case clang::APValue::ComplexFloat:
+			Log::Error("ComplexFloat not implemented");
+			break;
+		case clang::APValue::LValue:
+			Log::Error("LValue not implemented");
+			break;
+		case clang::APValue::Vector:
+			Log::Error("Vector not implemented");
+			break;
+		case clang::APValue::Array:
+			Log::Error("Array not implemented");
+			break;
+		case clang::APValue::Struct:
+			Log::Error("Struct not implemented");
+			break;
+		case clang::APValue::Union:
+			Log::Error("Union not implemented");
+			break;
+		case clang::APValue::MemberPointer:
+			Log::Error("MemberPointer not implemented");
+			break;
+		case clang::APValue::AddrLabelDiff:
+			Log::Error("AddrLabelDiff not implemented");
+			break;
+		default: break;
+		}
+		return false;
 	}
 } // namespace ClangIntrospection
\ No newline at end of file
@@ -1,10 +1,55 @@
 #pragma once
 
+#include "JobSystem/Cancellation.h"
 #include "SDKInfo.h"
 
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <span>
 
 namespace ClangIntrospection
 {
-	bool Introspect(const std::vector<std::string>& args, std::filesystem::path path, SDKInfo::Header* headerInfo);
+	// How much of clang's work a parse does
+	// Fast skips function bodies, warnings and typo correction, none of which end up in a header, Full runs all of it
+	enum class EIntrospectionProfile : std::uint8_t
+	{
+		Fast,
+		Full
+	};
+
+	// Files read while introspecting an SDK, memory mapped on first use and shared by every job of the SDK for the whole run
+	// Jobs after the first don't open, stat or read an include again, thread safe
+	class SDKFileSystem
+	{
+	public:
+		class Impl;
+
+	public:
+		SDKFileSystem();
+		SDKFileSystem(SDKFileSystem&& move) noexcept;
+		~SDKFileSystem();
+
+		SDKFileSystem& operator=(SDKFileSystem&& move) noexcept;
+
+		// Directories that don't change during the run, their listings answer lookups of files they don't contain without asking the disk
+		void addSearchDirectory(const std::filesystem::path& directory);
+
+		Impl& impl() const { return *m_Impl; }
+
+	private:
+		std::unique_ptr<Impl> m_Impl;
+	};
+
+	// Precompiles the system headers every SDK header starts with into pchPath
+	// Introspect only reuses it with "-include-pch pchPath" added to args and the same profile, the SDK's own headers stay out of it so their include guards don't hide them
+	bool PrecompilePrelude(const std::vector<std::string>& args, const std::filesystem::path& pchPath, SDKFileSystem* fileSystem = nullptr, EIntrospectionProfile profile = EIntrospectionProfile::Fast);
+
+	// Macro constants are evaluated in parallel on the job system, evaluation stops early once token is cancelled and the result is false
+	// dependencies receives every file on disk the parse read, for IntrospectionCache, without fileSystem files are read straight from disk
+	bool Introspect(const std::vector<std::string>& args, const std::filesystem::path& path, SDKInfo::Header* headerInfo, JobSystem::JobSystem& jobSystem, JobSystem::CancellationToken token = {}, std::vector<std::filesystem::path>* dependencies = nullptr, SDKFileSystem* fileSystem = nullptr, EIntrospectionProfile profile = EIntrospectionProfile::Fast);
+
+	// Parses all headers of an SDK as one translation unit that includes paths in order, so what they share is only parsed once
+	// Declarations and macros go to the headerInfos entry of the path they were written in
+	bool IntrospectSDK(const std::vector<std::string>& args, std::span<const std::filesystem::path> paths, std::span<SDKInfo::Header> headerInfos, JobSystem::JobSystem& jobSystem, JobSystem::CancellationToken token = {}, std::vector<std::filesystem::path>* dependencies = nullptr, SDKFileSystem* fileSystem = nullptr, EIntrospectionProfile profile = EIntrospectionProfile::Fast);
 }
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "IntrospectionCache.h"
+#include "Serialization/BinarySerialization.h"
+#include "Utils/Log.h"
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/SHA256.h>
+
+#include <cstdint>
+
+#include <fstream>
+
+namespace ClangIntrospection
+{
+	// Bump whenever introspection changes what it produces, entries of older versions are never hit again
+	// Changes to the layout of SDKInfo::Header don't need a bump, its binary schema is part of every key
+	static constexpr std::uint32_t c_CacheVersion = 2;
+
+	static bool ReadFile(const std::filesystem::path& path, std::string& content)
+	{
+		std::ifstream file { path, std::ios::binary | std::ios::ate };
+		if (!file)
+			return false;
+		content.resize(file.tellg());
+		file.seekg(0);
+		file.read(content.data(), content.size());
+		return static_cast<bool>(file);
+	}
+
+	static std::string Hash(std::string_view data)
+	{
+		auto hash = llvm::SHA256::hash({ reinterpret_cast<const std::uint8_t*>(data.data()), data.size() });
+		return llvm::toHex(hash, true);
+	}
+
+	IntrospectionCache::IntrospectionCache(std::filesystem::path directory)
+	    : m_Directory(std::move(directory))
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_Directory, error);
+	}
+
+	std::string IntrospectionCache::key(const std::vector<std::string>& args, std::span<const std::filesystem::path> paths)
+	{
+		std::string keyData;
+		Serialization::BinarySerialize(c_CacheVersion, keyData);
+		Serialization::BinarySerialize(Serialization::BinarySchema<SDKInfo::Header>(), keyData);
+		Serialization::BinarySerialize(args, keyData);
+		for (auto& path : paths)
+		{
+			std::string hash = fileHash(path);
+			if (hash.empty())
+				return {};
+			Serialization::BinarySerialize(hash, keyData);
+		}
+		return Hash(keyData);
+	}
+
+	bool IntrospectionCache::load(const std::string& key, std::span<SDKInfo::Header> headerInfos)
+	{
+		if (key.empty())
+			return false;
+
+		std::string content;
+		if (!ReadFile(m_Directory / (key + ".bin"), content))
+			return false;
+
+		std::string_view             in = content;
+		std::vector<std::string>     dependencies;
+		std::vector<std::string>     hashes;
+		std::vector<SDKInfo::Header> headers;
+		if (!Serialization::BinaryDeserialize(dependencies, in) ||
+		    !Serialization::BinaryDeserialize(hashes, in) ||
+		    !Serialization::BinaryDeserialize(headers, in) ||
+		    dependencies.size() != hashes.size() ||
+		    headers.size() != headerInfos.size() ||
+		    !in.empty())
+		{
+			Log::Warn("Ignoring malformed introspection cache entry '{}'", key);
+			return false;
+		}
+
+		for (std::size_t i = 0; i < dependencies.size(); ++i)
+			if (fileHash(dependencies[i]) != hashes[i])
+				return false;
+
+		for (std::size_t i = 0; i < headers.size(); ++i)
+		{
+			headers[i].name = std::move(headerInfos[i].name);
+			headerInfos[i]  = std::move(headers[i]);
+		}
+		return true;
+	}
+
+	bool IntrospectionCache::store(const std::string& key, std::span<const SDKInfo::Header> headerInfos, const std::vector<std::filesystem::path>& dependencies)
+	{
+		if (key.empty())
+			return false;
+
+		std::vector<std::string> paths;
+		std::vector<std::string> hashes;
+		paths.reserve(dependencies.size());
+		hashes.reserve(dependencies.size());
+		for (auto& dependency : dependencies)
+		{
+			std::string hash = fileHash(dependency);
+			if (hash.empty())
+				return false;
+			paths.emplace_back(dependency.string());
+			hashes.emplace_back(std::move(hash));
+		}
+
+		std::string content;
+		Serialization::BinarySerialize(paths, content);
+		Serialization::BinarySerialize(hashes, content);
+		Serialization::BinarySerialize(static_cast<std::uint64_t>(headerInfos.size()), content);
+		for (auto& headerInfo : headerInfos)
+			Serialization::BinarySerialize(headerInfo, content);
+
+		// Readers only ever see complete entries
+		auto path    = m_Directory / (key + ".bin");
+		auto tmpPath = m_Directory / (key + ".tmp");
+		{
+			std::ofstream file { tmpPath, std::ios::binary };
+			if (!file || !file.write(content.data(), content.size()))
+				return false;
+		}
+		std::error_code error;
+		std::filesystem::rename(tmpPath, path, error);
+		if (error)
+		{
+			Log::Warn("Failed to store introspection cache entry '{}': {}", key, error.message());
+			return false;
+		}
+		return true;
+	}
+
+	std::string IntrospectionCache::fileHash(const std::filesystem::path& path)
+	{
+		std::string pathStr = path.string();
+		{
+			std::lock_guard lock { m_Mutex };
+			auto            itr = m_FileHashes.find(pathStr);
+			if (itr != m_FileHashes.end())
+				return itr->second;
+		}
+
+		// Hashing happens outside of the lock, two jobs hashing the same file just agree on the result
+		std::string content;
+		std::string hash;
+		if (ReadFile(path, content))
+			hash = Hash(content);
+
+		std::lock_guard lock { m_Mutex };
+		return m_FileHashes.try_emplace(std::move(pathStr), std::move(hash)).first->second;
+	}
+} // namespace ClangIntrospection
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "SDKInfo.h"
+
+#include <filesystem>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ClangIntrospection
+{
+	// Introspected headers on disk, addressed by the contents of the introspected files and the args
+	// Every entry lists the files the parse read with their hashes, and only counts as a hit while all of them are unchanged
+	class IntrospectionCache
+	{
+	public:
+		IntrospectionCache(std::filesystem::path directory);
+
+		// paths are the files passed to Introspect or IntrospectSDK, an empty key means one of them couldn't be read
+		std::string key(const std::vector<std::string>& args, std::span<const std::filesystem::path> paths);
+
+		// Fills headerInfos from the entry of key, their names are left alone
+		bool load(const std::string& key, std::span<SDKInfo::Header> headerInfos);
+		bool store(const std::string& key, std::span<const SDKInfo::Header> headerInfos, const std::vector<std::filesystem::path>& dependencies);
+
+	private:
+		// Every file is hashed once per run, all headers of an sdk include mostly the same files
+		std::string fileHash(const std::filesystem::path& path);
+
+	private:
+		std::filesystem::path m_Directory;
+
+		std::mutex                                   m_Mutex;
+		std::unordered_map<std::string, std::string> m_FileHashes;
+	};
+} // namespace ClangIntrospection
\ No newline at end of file
@@ -0,0 +1,427 @@
+#include "IntrospectionProcess.h"
+#include "HeaderIntrospectionStage.h"
+#include "JobSystem/JobSystem.h"
+#include "Serialization/BinarySerialization.h"
+#include "Utils/Core.h"
+#include "Utils/Exception.h"
+#include "Utils/Log.h"
+
+#include <cstdint>
+
+#include <algorithm>
+#include <string_view>
+
+#if BUILD_IS_SYSTEM_WINDOWS
+	#include <Windows.h>
+#elif BUILD_IS_SYSTEM_UNIX
+	#include <fcntl.h>
+	#include <sys/wait.h>
+	#include <unistd.h>
+
+	#include <cerrno>
+	#include <csignal>
+
+	#if BUILD_IS_SYSTEM_MACOSX
+		#include <mach-o/dyld.h>
+	#endif
+#endif
+
+namespace ClangIntrospection
+{
+#if BUILD_IS_SYSTEM_WINDOWS
+	using NativeHandle = HANDLE;
+
+	static constexpr NativeHandle c_NoHandle = nullptr;
+#else
+	using NativeHandle = int;
+
+	static constexpr NativeHandle c_NoHandle = -1;
+#endif
+
+	// Times a header is handed to a new child after the previous one died on it
+	static constexpr std::size_t c_CrashRetries = 1;
+
+	static bool WriteAll(NativeHandle handle, const char* data, std::size_t size)
+	{
+		while (size > 0)
+		{
+#if BUILD_IS_SYSTEM_WINDOWS
+			DWORD written = 0;
+			if (!WriteFile(handle, data, static_cast<DWORD>(std::min<std::size_t>(size, 1 << 30)), &written, nullptr))
+				return false;
+#else
+			ssize_t written = ::write(handle, data, size);
+			if (written < 0 && errno == EINTR)
+				continue;
+			if (written <= 0)
+				return false;
+#endif
+			data += written;
+			size -= static_cast<std::size_t>(written);
+		}
+		return true;
+	}
+
+	static bool ReadAll(NativeHandle handle, char* data, std::size_t size)
+	{
+		while (size > 0)
+		{
+#if BUILD_IS_SYSTEM_WINDOWS
+			DWORD read = 0;
+			if (!ReadFile(handle, data, static_cast<DWORD>(std::min<std::size_t>(size, 1 << 30)), &read, nullptr) || read == 0)
+				return false;
+#else
+			ssize_t read = ::read(handle, data, size);
+			if (read < 0 && errno == EINTR)
+				continue;
+			if (read <= 0)
+				return false;
+#endif
+			data += read;
+			size -= static_cast<std::size_t>(read);
+		}
+		return true;
+	}
+
+	static void CloseNativeHandle(NativeHandle& handle)
+	{
+		if (handle == c_NoHandle)
+			return;
+#if BUILD_IS_SYSTEM_WINDOWS
+		CloseHandle(handle);
+#else
+		::close(handle);
+#endif
+		handle = c_NoHandle;
+	}
+
+	static NativeHandle ParseNativeHandle(const std::string& str)
+	{
+#if BUILD_IS_SYSTEM_WINDOWS
+		return reinterpret_cast<NativeHandle>(static_cast<std::uintptr_t>(std::strtoull(str.c_str(), nullptr, 10)));
+#else
+		return static_cast<NativeHandle>(std::strtol(str.c_str(), nullptr, 10));
+#endif
+	}
+
+	// Every message is its size followed by that many bytes
+	static bool WriteFrame(NativeHandle handle, const std::string& payload)
+	{
+		std::uint64_t size = payload.size();
+		return WriteAll(handle, reinterpret_cast<const char*>(&size), sizeof(size)) && WriteAll(handle, payload.data(), payload.size());
+	}
+
+	static bool ReadFrame(NativeHandle handle, std::string& payload)
+	{
+		std::uint64_t size = 0;
+		if (!ReadAll(handle, reinterpret_cast<char*>(&size), sizeof(size)))
+			return false;
+		payload.resize(size);
+		return ReadAll(handle, payload.data(), payload.size());
+	}
+
+	static std::filesystem::path GetExecutablePath()
+	{
+#if BUILD_IS_SYSTEM_WINDOWS
+		std::wstring path(MAX_PATH, L'\0');
+		while (true)
+		{
+			DWORD length = GetModuleFileNameW(nullptr, path.data(), static_cast<DWORD>(path.size()));
+			if (length < path.size())
+			{
+				path.resize(length);
+				return path;
+			}
+			path.resize(path.size() * 2);
+		}
+#elif BUILD_IS_SYSTEM_MACOSX
+		std::uint32_t size = 0;
+		_NSGetExecutablePath(nullptr, &size);
+		std::string path(size, '\0');
+		_NSGetExecutablePath(path.data(), &size);
+		return path.c_str();
+#else
+		return std::filesystem::read_symlink("/proc/self/exe");
+#endif
+	}
+
+	struct IntrospectionProcessPool::Process
+	{
+	public:
+		static std::unique_ptr<Process> Spawn(std::size_t threadCount);
+
+		~Process()
+		{
+			// Closing its input makes the child exit once it is done with the current request
+			CloseNativeHandle(m_Input);
+			CloseNativeHandle(m_Output);
+#if BUILD_IS_SYSTEM_WINDOWS
+			WaitForSingleObject(m_Process, INFINITE);
+			CloseHandle(m_Process);
+#else
+			int status = 0;
+			while (waitpid(m_Pid, &status, 0) < 0 && errno == EINTR)
+				;
+#endif
+		}
+
+		void terminate()
+		{
+#if BUILD_IS_SYSTEM_WINDOWS
+			TerminateProcess(m_Process, 1);
+#else
+			kill(m_Pid, SIGKILL);
+#endif
+		}
+
+	public:
+		// We write requests to m_Input and read results from m_Output
+		NativeHandle m_Input  = c_NoHandle;
+		NativeHandle m_Output = c_NoHandle;
+#if BUILD_IS_SYSTEM_WINDOWS
+		HANDLE m_Process = nullptr;
+#else
+		pid_t m_Pid = -1;
+#endif
+	};
+
+	// Only called with the pool locked, pipes created concurrently would leak into each other's children and never report a dead child
+	std::unique_ptr<IntrospectionProcessPool::Process> IntrospectionProcessPool::Process::Spawn(std::size_t threadCount)
+	{
+		auto executable = GetExecutablePath();
+#if BUILD_IS_SYSTEM_WINDOWS
+		SECURITY_ATTRIBUTES security { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+		HANDLE              childInput = nullptr, input = nullptr, output = nullptr, childOutput = nullptr;
+		if (!CreatePipe(&childInput, &input, &security, 0))
+			return nullptr;
+		if (!CreatePipe(&output, &childOutput, &security, 0))
+		{
+			CloseHandle(childInput);
+			CloseHandle(input);
+			return nullptr;
+		}
+		SetHandleInformation(input, HANDLE_FLAG_INHERIT, 0);
+		SetHandleInformation(output, HANDLE_FLAG_INHERIT, 0);
+
+		std::wstring commandLine = L"\"" + executable.wstring() + L"\" --introspect-worker " +
+		                           std::to_wstring(reinterpret_cast<std::uintptr_t>(childInput)) + L" " +
+		                           std::to_wstring(reinterpret_cast<std::uintptr_t>(childOutput)) + L" -j " +
+		                           std::to_wstring(threadCount);
+		// The child shares our console and output, so its logs and whatever it prints while crashing aren't lost
+		HANDLE stdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+		HANDLE stdError  = GetStdHandle(STD_ERROR_HANDLE);
+		for (HANDLE handle : { stdOutput, stdError })
+			if (handle && handle != INVALID_HANDLE_VALUE)
+				SetHandleInformation(handle, HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT);
+		STARTUPINFOW startup { sizeof(STARTUPINFOW) };
+		startup.dwFlags    = STARTF_USESTDHANDLES;
+		startup.hStdInput  = nullptr;
+		startup.hStdOutput = stdOutput;
+		startup.hStdError  = stdError;
+		PROCESS_INFORMATION info {};
+		BOOL                created = CreateProcessW(executable.c_str(), commandLine.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startup, &info);
+		CloseHandle(childInput);
+		CloseHandle(childOutput);
+		if (!created)
+		{
+			CloseHandle(input);
+			CloseHandle(output);
+			return nullptr;
+		}
+		CloseHandle(info.hThread);
+
+		auto process       = std::make_unique<Process>();
+		process->m_Input   = input;
+		process->m_Output  = output;
+		process->m_Process = info.hProcess;
+		return process;
+#else
+		int toChild[2], fromChild[2];
+		if (pipe(toChild) != 0)
+			return nullptr;
+		if (pipe(fromChild) != 0)
+		{
+			::close(toChild[0]);
+			::close(toChild[1]);
+			return nullptr;
+		}
+		fcntl(toChild[1], F_SETFD, FD_CLOEXEC);
+		fcntl(fromChild[0], F_SETFD, FD_CLOEXEC);
+
+		// Only async signal safe calls are allowed between fork and exec, so build the arguments first
+		std::string executableStr = executable.string();
+		std::string inputStr      = std::to_string(toChild[0]);
+		std::string outputStr     = std::to_string(fromChild[1]);
+		std::string threadsStr    = std::to_string(threadCount);
+		const char* argv[]        = { executableStr.c_str(), "--introspect-worker", inputStr.c_str(), outputStr.c_str(), "-j", threadsStr.c_str(), nullptr };
+
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			execv(executableStr.c_str(), const_cast<char* const*>(argv));
+			_exit(127);
+		}
+		::close(toChild[0]);
+		::close(fromChild[1]);
+		if (pid < 0)
+		{
+			::close(toChild[1]);
+			::close(fromChild[0]);
+			return nullptr;
+		}
+
+		auto process      = std::make_unique<Process>();
+		process->m_Input  = toChild[1];
+		process->m_Output = fromChild[0];
+		process->m_Pid    = pid;
+		return process;
+#endif
+	}
+
+	IntrospectionProcessPool::IntrospectionProcessPool(std::size_t processCount, std::size_t threadCount)
+	    : m_ProcessCount(std::max<std::size_t>(processCount, 1)), m_ThreadCount(threadCount)
+	{
+#if BUILD_IS_SYSTEM_UNIX
+		// Writing to a dead child has to fail instead of killing us
+		std::signal(SIGPIPE, SIG_IGN);
+#endif
+	}
+
+	IntrospectionProcessPool::~IntrospectionProcessPool() = default;
+
+	EProcessResult IntrospectionProcessPool::introspect(const std::vector<std::string>& args, const std::filesystem::path& path, SDKInfo::Header* headerInfo, std::vector<std::filesystem::path>* dependencies, EIntrospectionProfile profile)
+	{
+		std::string request;
+		Serialization::BinarySerialize(args, request);
+		Serialization::BinarySerialize(path.string(), request);
+		Serialization::BinarySerialize(headerInfo->name, request);
+		Serialization::BinarySerialize(static_cast<std::uint8_t>(profile), request);
+
+		std::string response;
+		for (std::size_t attempt = 0;; ++attempt)
+		{
+			auto process = acquire();
+			if (!process)
+			{
+				Log::Error("Failed to start an introspection process for '{}'", path.string());
+				return EProcessResult::Failure;
+			}
+
+			if (WriteFrame(process->m_Input, request) && ReadFrame(process->m_Output, response))
+			{
+				release(std::move(process));
+				break;
+			}
+
+			process->terminate();
+			process.reset();
+			release(nullptr);
+			// A child may also die of something the header has nothing to do with, so only a second death counts
+			if (attempt >= c_CrashRetries)
+			{
+				Log::Error("Introspection process died while working on '{}', giving up on it", path.string());
+				return EProcessResult::Crash;
+			}
+			Log::Warn("Introspection process died while working on '{}', retrying in a new process", path.string());
+		}
+
+		std::string_view         in     = response;
+		std::uint8_t             result = 0;
+		SDKInfo::Header          header;
+		std::vector<std::string> headerDependencies;
+		if (!Serialization::BinaryDeserialize(result, in) ||
+		    !Serialization::BinaryDeserialize(header, in) ||
+		    !Serialization::BinaryDeserialize(headerDependencies, in) ||
+		    !in.empty())
+		{
+			Log::Error("Introspection process sent a malformed result for '{}'", path.string());
+			return EProcessResult::Failure;
+		}
+		*headerInfo = std::move(header);
+		if (dependencies)
+			dependencies->assign(headerDependencies.begin(), headerDependencies.end());
+		return result != 0 ? EProcessResult::Success : EProcessResult::Failure;
+	}
+
+	std::unique_ptr<IntrospectionProcessPool::Process> IntrospectionProcessPool::acquire()
+	{
+		std::unique_lock lock { m_Mutex };
+		m_Released.wait(lock, [this]() { return !m_Idle.empty() || m_Spawned < m_ProcessCount; });
+		if (!m_Idle.empty())
+		{
+			auto process = std::move(m_Idle.back());
+			m_Idle.pop_back();
+			return process;
+		}
+
+		auto process = Process::Spawn(m_ThreadCount);
+		if (process)
+			++m_Spawned;
+		return process;
+	}
+
+	void IntrospectionProcessPool::release(std::unique_ptr<Process> process)
+	{
+		{
+			std::lock_guard lock { m_Mutex };
+			if (process)
+				m_Idle.emplace_back(std::move(process));
+			else
+				--m_Spawned;
+		}
+		m_Released.notify_one();
+	}
+
+	int RunIntrospectionWorker(const std::string& input, const std::string& output, std::size_t threadCount)
+	{
+		NativeHandle inputHandle  = ParseNativeHandle(input);
+		NativeHandle outputHandle = ParseNativeHandle(output);
+
+		JobSystem::JobSystem jobSystem { threadCount };
+		std::string          request;
+		std::string          response;
+		while (ReadFrame(inputHandle, request))
+		{
+			std::string_view         in = request;
+			std::vector<std::string> args;
+			std::string              path;
+			SDKInfo::Header          header;
+			std::uint8_t             profile = 0;
+			if (!Serialization::BinaryDeserialize(args, in) ||
+			    !Serialization::BinaryDeserialize(path, in) ||
+			    !Serialization::BinaryDeserialize(header.name, in) ||
+			    !Serialization::BinaryDeserialize(profile, in))
+			{
+				Log::Critical("Received a malformed introspection request");
+				return 1;
+			}
+
+			bool                               result = false;
+			std::vector<std::filesystem::path> dependencies;
+			try
+			{
+				result = Introspect(args, path, &header, jobSystem, {}, &dependencies, nullptr, static_cast<EIntrospectionProfile>(profile));
+			}
+			catch (const Utils::Exception& exception)
+			{
+				Log::GetOrCreateLogger(exception.title())->critical("{}", exception);
+			}
+			catch (const std::exception& exception)
+			{
+				Log::Critical("{}", exception.what());
+			}
+
+			response.clear();
+			Serialization::BinarySerialize(static_cast<std::uint8_t>(result), response);
+			Serialization::BinarySerialize(header, response);
+			Serialization::BinarySerialize(static_cast<std::uint64_t>(dependencies.size()), response);
+			for (auto& dependency : dependencies)
+				Serialization::BinarySerialize(dependency.string(), response);
+			if (!WriteFrame(outputHandle, response))
+				return 1;
+		}
+		CloseNativeHandle(inputHandle);
+		CloseNativeHandle(outputHandle);
+		return 0;
+	}
+} // namespace ClangIntrospection
\ No newline at end of file
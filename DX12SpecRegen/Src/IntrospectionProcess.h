@@ -0,0 +1,59 @@
+#pragma once
+
+#include "HeaderIntrospectionStage.h"
+#include "SDKInfo.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ClangIntrospection
+{
+	// How a request to the pool ended, a crash only loses the header it was working on
+	enum class EProcessResult : std::uint8_t
+	{
+		Success,
+		Failure,
+		Crash
+	};
+
+	// Runs Introspect in child processes of this executable, so clang's memory and global state are split across processes
+	// A crashing child only loses the header it was working on, the next request spawns a replacement
+	class IntrospectionProcessPool
+	{
+	public:
+		// Every child gets its own job system with threadCount workers for evaluating macros
+		IntrospectionProcessPool(std::size_t processCount, std::size_t threadCount);
+		~IntrospectionProcessPool();
+
+		std::size_t processCount() const { return m_ProcessCount; }
+
+		// Blocks until a child is free and then until it answered, a header whose child died is retried once in a new child before giving up with Crash
+		// Job system workers waiting here can't help, so keep at most processCount() requests in flight from jobs
+		EProcessResult introspect(const std::vector<std::string>& args, const std::filesystem::path& path, SDKInfo::Header* headerInfo, std::vector<std::filesystem::path>* dependencies = nullptr, EIntrospectionProfile profile = EIntrospectionProfile::Fast);
+
+	private:
+		struct Process;
+
+	private:
+		std::unique_ptr<Process> acquire();
+		void                     release(std::unique_ptr<Process> process);
+
+	private:
+		std::size_t m_ProcessCount;
+		std::size_t m_ThreadCount;
+
+		std::mutex                            m_Mutex;
+		std::condition_variable               m_Released;
+		std::vector<std::unique_ptr<Process>> m_Idle;
+		std::size_t                           m_Spawned = 0;
+	};
+
+	// Entry point of the children, serves requests from the given pipe handles until the input closes
+	int RunIntrospectionWorker(const std::string& input, const std::string& output, std::size_t threadCount);
+} // namespace ClangIntrospection
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace JobSystem
+{
+	// Shared flag a group of jobs polls, jobs created with a cancelled token are skipped and one failing cancels its token for everyone else
+	// A default constructed token is empty and can never be cancelled
+	class CancellationToken
+	{
+	public:
+		static CancellationToken Create() { return CancellationToken { std::make_shared<std::atomic_bool>(false) }; }
+
+	public:
+		CancellationToken() = default;
+
+		void cancel()
+		{
+			if (m_State)
+				m_State->store(true, std::memory_order_release);
+		}
+		bool cancelled() const { return m_State && m_State->load(std::memory_order_acquire); }
+
+		explicit operator bool() const { return static_cast<bool>(m_State); }
+
+	private:
+		explicit CancellationToken(std::shared_ptr<std::atomic_bool> state) : m_State(std::move(state)) {}
+
+	private:
+		std::shared_ptr<std::atomic_bool> m_State;
+	};
+} // namespace JobSystem
\ No newline at end of file
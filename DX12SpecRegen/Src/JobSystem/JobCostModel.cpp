@@ -0,0 +1,68 @@
+#include "JobCostModel.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace JobSystem
+{
+	bool JobCostModel::load(const std::filesystem::path& path)
+	{
+		std::ifstream file { path };
+		if (!file)
+			return false;
+
+		std::lock_guard lock { m_Mutex };
+		std::uint64_t   cost = 0;
+		std::string     name;
+		while (file >> cost && std::getline(file >> std::ws, name))
+		{
+			auto [itr, inserted] = m_Costs.try_emplace(std::move(name), cost);
+			if (!inserted)
+			{
+				m_TotalCost  -= itr->second;
+				itr->second   = cost;
+			}
+			m_TotalCost += cost;
+		}
+		return true;
+	}
+
+	bool JobCostModel::save(const std::filesystem::path& path) const
+	{
+		std::ofstream file { path };
+		if (!file)
+			return false;
+
+		std::lock_guard lock { m_Mutex };
+		for (auto& [name, cost] : m_Costs)
+			file << cost << ' ' << name << '\n';
+		return true;
+	}
+
+	std::uint64_t JobCostModel::estimate(std::string_view name) const
+	{
+		std::lock_guard lock { m_Mutex };
+		auto            itr = m_Costs.find(name);
+		if (itr != m_Costs.end())
+			return std::max<std::uint64_t>(itr->second, 1);
+		if (m_Costs.empty())
+			return 1;
+		return std::max<std::uint64_t>(m_TotalCost / m_Costs.size(), 1);
+	}
+
+	void JobCostModel::record(std::string_view name, std::uint64_t microseconds)
+	{
+		std::lock_guard lock { m_Mutex };
+		auto            itr = m_Costs.find(name);
+		if (itr == m_Costs.end())
+		{
+			m_Costs.emplace(std::string { name }, microseconds);
+		}
+		else
+		{
+			m_TotalCost -= itr->second;
+			itr->second  = microseconds;
+		}
+		m_TotalCost += microseconds;
+	}
+} // namespace JobSystem
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace JobSystem
+{
+	// Per job name run times from previous runs, used to estimate critical paths
+	class JobCostModel
+	{
+	public:
+		bool load(const std::filesystem::path& path);
+		bool save(const std::filesystem::path& path) const;
+
+		// Estimated cost in microseconds, unknown jobs are assumed to cost as much as the average known job
+		std::uint64_t estimate(std::string_view name) const;
+		void          record(std::string_view name, std::uint64_t microseconds);
+
+	private:
+		struct StringHash
+		{
+		public:
+			using is_transparent = void;
+
+			std::size_t operator()(std::string_view str) const { return std::hash<std::string_view> {}(str); }
+		};
+
+	private:
+		mutable std::mutex                                                          m_Mutex;
+		std::unordered_map<std::string, std::uint64_t, StringHash, std::equal_to<>> m_Costs;
+		std::uint64_t                                                               m_TotalCost = 0;
+	};
+} // namespace JobSystem
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include "JobGraph.h"
+#include "Utils/Exception.h"
+
+namespace JobSystem
+{
+	JobGraph::Node JobGraph::add(Job::Func&& func, EJobPriority priority, std::string_view name, CancellationToken token)
+	{
+		auto& node      = m_Nodes.emplace_back();
+		node.m_Func     = std::move(func);
+		node.m_Priority = priority;
+		node.m_Name.assign(name);
+		node.m_Token = std::move(token);
+		return m_Nodes.size() - 1;
+	}
+
+	void JobGraph::addEdge(Node from, Node to)
+	{
+		Assert(from < m_Nodes.size() && to < m_Nodes.size(), "Job graph edge references a node that doesn't exist");
+		m_Nodes[to].m_Dependencies.emplace_back(from);
+	}
+
+	void JobGraph::addDependency(Node node, JobRef job)
+	{
+		Assert(node < m_Nodes.size(), "Job graph dependency references a node that doesn't exist");
+		m_Nodes[node].m_External.emplace_back(job);
+	}
+} // namespace JobSystem
\ No newline at end of file
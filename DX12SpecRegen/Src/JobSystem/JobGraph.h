@@ -0,0 +1,47 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace JobSystem
+{
+	// Collects jobs and the edges between them without touching the job system, JobSystem::submit creates the whole graph in one go
+	// Nothing of the graph starts before all of it exists, so half built graphs never run and critical path ranks are complete
+	class JobGraph
+	{
+	public:
+		using Node = std::size_t;
+
+	public:
+		Node add(Job::Func&& func, EJobPriority priority = EJobPriority::Normal, std::string_view name = {}, CancellationToken token = {});
+		// to runs once from finished, nodes may be added in any order but the edges must not form a cycle
+		void addEdge(Node from, Node to);
+		// node also waits on a job outside the graph
+		void addDependency(Node node, JobRef job);
+
+		std::size_t size() const { return m_Nodes.size(); }
+		bool        empty() const { return m_Nodes.empty(); }
+
+		void clear() { m_Nodes.clear(); }
+
+	private:
+		struct NodeDesc
+		{
+		public:
+			Job::Func           m_Func;
+			EJobPriority        m_Priority;
+			std::string         m_Name;
+			CancellationToken   m_Token;
+			std::vector<Node>   m_Dependencies;
+			std::vector<JobRef> m_External;
+		};
+
+	private:
+		std::vector<NodeDesc> m_Nodes;
+
+		friend class JobSystem;
+	};
+} // namespace JobSystem
\ No newline at end of file
@@ -1,47 +1,133 @@
 #include "JobSystem.h"
+#include "JobGraph.h"
 #include "Utils/Exception.h"
 #include "Utils/Log.h"
 
+#include <algorithm>
+#include <chrono>
+
 namespace JobSystem
 {
-	JobRef::JobRef(JobSystem* jobSystem, Job* job)
-	    : m_JobSystem(jobSystem), m_Job(job)
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr std::int64_t c_DepthSampleInterval = 1'000'000;
+
+	template <class T>
+	static void AtomicMax(std::atomic<T>& atomic, T value)
+	{
+		T current = atomic.load(std::memory_order_relaxed);
+		while (current < value && !atomic.compare_exchange_weak(current, value, std::memory_order_relaxed))
+			;
+	}
+
+	static std::uint64_t Nanoseconds(Clock::duration duration)
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+	}
+
+	bool JobRef::done() const
+	{
+		return !m_JobSystem || m_JobSystem->isJobDone(*this);
+	}
+
+	bool JobRef::dependencyFailed() const
+	{
+		return m_JobSystem && m_JobSystem->isDependencyFailed(*this);
+	}
+
+	bool JobRef::cancelled() const
 	{
-		++m_Job->m_Refs;
+		return m_JobSystem && m_JobSystem->isJobCancelled(*this);
 	}
 
-	JobRef::~JobRef()
+	std::pmr::memory_resource* JobRef::scratch() const
 	{
-		if (m_JobSystem && m_Job && --m_Job->m_Refs == 0 && m_Job->m_Done)
-			m_JobSystem->killJob(*this);
+		return m_JobSystem ? m_JobSystem->scratch() : std::pmr::new_delete_resource();
 	}
 
 	void JobRef::reset()
 	{
-		m_Job       = nullptr;
-		m_JobSystem = nullptr;
+		m_JobSystem  = nullptr;
+		m_Index      = 0;
+		m_Generation = 0;
 	}
 
-	JobSystem::JobSystem(std::size_t numThreads)
-	    : m_Alive(true)
+	thread_local JobSystem::Worker* JobSystem::tl_CurrentWorker = nullptr;
+	thread_local std::uint32_t      JobSystem::tl_StealSeed     = 0x9E37'79B9U;
+
+	JobSystem::JobSystem(std::size_t numThreads, bool pinThreads, JobCostModel* costModel)
+	    : m_CostModel(costModel), m_StartTime(Clock::now()), m_LastDepthSample(0), m_Alive(true)
 	{
-		m_Threads.reserve(numThreads);
+		if (numThreads == 0)
+			numThreads = GetAvailableConcurrency();
+		std::vector<ProcessorCore> cores;
+		if (pinThreads)
+			cores = GetAvailableCores();
+
+		// All deques have to exist before any worker starts stealing from them
+		m_Workers.reserve(numThreads);
 		for (std::size_t i = 0; i < numThreads; ++i)
-			m_Threads.emplace_back(&JobSystem::ThreadFunc, this);
+		{
+			auto& worker        = m_Workers.emplace_back(std::make_unique<Worker>());
+			worker->m_JobSystem = this;
+			worker->m_Index     = static_cast<std::uint32_t>(i);
+			worker->m_Seed      = static_cast<std::uint32_t>(i * 0x9E37'79B9U + 1);
+			worker->m_Pinned    = !cores.empty();
+			if (worker->m_Pinned)
+				worker->m_Core = cores[i % cores.size()];
+		}
+		for (auto& worker : m_Workers)
+			worker->m_Thread = std::thread(&JobSystem::ThreadFunc, this, worker.get());
 	}
 
 	JobSystem::~JobSystem()
 	{
 		kill();
-
-		for (auto& job : m_Jobs)
-			for (auto& signal : job->m_Signals)
-				signal.reset();
 	}
 
-	void JobSystem::waitForJob(JobRef job)
+	void JobSystem::waitForJob(JobRef job, bool help)
 	{
-		job.m_Job->m_Done.wait(false);
+		if (!job.valid() || isJobDone(job))
+			return;
+
+		auto&         waitJob   = m_Jobs[job.m_Index];
+		bool          traced    = m_Tracer.enabled();
+		std::int64_t  waitBegin = traced ? m_Tracer.now() : 0;
+		std::uint64_t waitId    = traced ? waitJob.m_TraceId.load(std::memory_order_acquire) : 0;
+
+		Worker* worker = tl_CurrentWorker && tl_CurrentWorker->m_JobSystem == this ? tl_CurrentWorker : nullptr;
+		while (!help)
+		{
+			std::uint64_t state = waitJob.m_State.load(std::memory_order_acquire);
+			if (Job::StateGeneration(state) != job.m_Generation || Job::StateContinuations(state) == Job::c_Finished)
+				break;
+			waitJob.m_State.wait(state, std::memory_order_acquire);
+		}
+		while (help && !isJobDone(job))
+		{
+			auto nextJob = getNextJob(worker);
+			if (nextJob == nullptr)
+			{
+				// Sleep like an idle worker, finishJob bumps the epoch while helpers sleep so we also wake once our job is done
+				++m_Helpers;
+				++m_Sleepers;
+				std::uint64_t expected = m_JobAtomic.load();
+				if (!isJobDone(job))
+				{
+					nextJob = getNextJob(worker);
+					if (nextJob == nullptr && m_Alive)
+						m_JobAtomic.wait(expected);
+				}
+				--m_Sleepers;
+				--m_Helpers;
+				if (nextJob == nullptr)
+					continue;
+			}
+			runJob(nextJob);
+		}
+
+		if (traced)
+			traceBuffer().m_Events.emplace_back(JobTracer::Event { ETraceEventType::Wait, waitId, waitBegin, m_Tracer.now(), 0, 0, {} });
 	}
 
 	void JobSystem::kill()
@@ -49,110 +135,229 @@ namespace JobSystem
 		m_Alive = false;
 		m_JobAtomic.fetch_add(1);
 		m_JobAtomic.notify_all();
-		for (auto& thread : m_Threads)
-			thread.join();
+		for (auto& worker : m_Workers)
+			if (worker->m_Thread.joinable())
+				worker->m_Thread.join();
 	}
 
-	void JobSystem::killJob(JobRef job)
+	JobRef JobSystem::createJob(Job::Func&& func, const std::vector<JobRef>& dependencies, EJobPriority priority, std::string_view name, CancellationToken token)
 	{
-		m_JobMutex.lock();
-		auto itr = std::find_if(m_Jobs.begin(), m_Jobs.end(),
-		                        [job](const std::unique_ptr<Job>& j) -> bool
-		                        {
-			                        return j.get() == job.m_Job;
-		                        });
-		m_Jobs.erase(itr);
-		m_JobMutex.unlock();
+		return addJob(std::move(func), dependencies, priority, name, 0, false, std::move(token));
 	}
 
-	JobRef JobSystem::createJob(Job::Func&& func, const std::vector<JobRef>& dependencies)
+	JobRef JobSystem::createContinuation(Job::Func&& func, const std::vector<JobRef>& dependencies, EJobPriority priority, std::string_view name)
 	{
-		m_JobMutex.lock();
-		auto job = m_Jobs.emplace_back(std::make_unique<Job>(std::move(func), dependencies.size())).get();
-		m_JobMutex.unlock();
-		++m_JobsLeft;
-		for (auto dependency : dependencies)
+		return addJob(std::move(func), dependencies, priority, name, 0, true, {});
+	}
+
+	JobRef JobSystem::createEvent()
+	{
+		return addJob(nullptr, {}, EJobPriority::High, {}, 1, false, {});
+	}
+
+	void JobSystem::signalEvent(JobRef event, bool failed)
+	{
+		auto& job = m_Jobs[event.m_Index];
+		if (failed)
+			job.m_Failed.store(true, std::memory_order_relaxed);
+		if (--job.m_ReadyCounter == 0)
 		{
-			if (dependency.m_Job->m_Done)
-				--job->m_ReadyCounter;
-			else
-				dependency.m_Job->m_Signals.emplace_back(this, job);
+			readyJob(&job);
+			wakeWorkers(1);
 		}
-		m_JobAtomic.fetch_add(1);
-		m_JobAtomic.notify_one();
-		return { this, job };
 	}
 
-	void JobSystem::SafeThreadFunc()
+	std::vector<JobRef> JobSystem::submit(JobGraph&& graph)
 	{
-		while (m_Alive)
+		auto&       nodes = graph.m_Nodes;
+		std::size_t count = nodes.size();
+
+		// Dependencies have to exist before their dependents, so create the jobs in topological order
+		std::vector<std::size_t>                 pending(count);
+		std::vector<std::vector<JobGraph::Node>> dependents(count);
+		std::vector<JobGraph::Node>              order;
+		order.reserve(count);
+		for (JobGraph::Node node = 0; node < count; ++node)
+		{
+			pending[node] = nodes[node].m_Dependencies.size();
+			for (auto dependency : nodes[node].m_Dependencies)
+				dependents[dependency].emplace_back(node);
+			if (pending[node] == 0)
+				order.emplace_back(node);
+		}
+		for (std::size_t i = 0; i < order.size(); ++i)
+			for (auto dependent : dependents[order[i]])
+				if (--pending[dependent] == 0)
+					order.emplace_back(dependent);
+		if (order.size() != count)
+			throw Utils::Exception("JobSystem", "Job graph contains a cycle");
+
+		// Every job is held back until the whole graph exists
+		std::vector<JobRef> refs(count);
+		std::vector<JobRef> dependencies;
+		for (auto node : order)
 		{
-			m_JobMutex.lock();
-			if (m_Jobs.empty())
+			auto& desc = nodes[node];
+			dependencies.assign(desc.m_External.begin(), desc.m_External.end());
+			for (auto dependency : desc.m_Dependencies)
+				dependencies.emplace_back(refs[dependency]);
+			refs[node] = addJob(std::move(desc.m_Func), dependencies, desc.m_Priority, desc.m_Name, 1, false, std::move(desc.m_Token));
+		}
+		graph.clear();
+
+		// A held job can't finish, so every ref is still live until its own hold is released
+		std::size_t readied = 0;
+		for (auto& ref : refs)
+		{
+			auto& job = m_Jobs[ref.m_Index];
+			if (--job.m_ReadyCounter == 0)
 			{
-				m_JobMutex.unlock();
-				std::uint64_t expected = m_JobAtomic.load();
-				m_JobAtomic.wait(expected);
-				continue;
+				readyJob(&job);
+				++readied;
 			}
-			auto job = getNextJob();
-			if (job == nullptr)
+		}
+		wakeWorkers(readied);
+		return refs;
+	}
+
+	JobRef JobSystem::addJob(Job::Func&& func, const std::vector<JobRef>& dependencies, EJobPriority priority, std::string_view name, std::size_t holds, bool alwaysRun, CancellationToken token)
+	{
+		std::uint32_t index      = m_Jobs.allocate();
+		auto&         job        = m_Jobs[index];
+		std::uint32_t generation = Job::StateGeneration(job.m_State.load(std::memory_order_relaxed));
+		job.m_Func               = std::move(func);
+		job.m_Index              = index;
+		job.m_Priority           = priority;
+		job.m_Name.assign(name);
+		job.m_Failed.store(false, std::memory_order_relaxed);
+		job.m_AlwaysRun = alwaysRun;
+		job.m_Token     = std::move(token);
+		if (m_CostModel)
+			rankJob(&job, dependencies);
+		std::uint64_t traceId = 0;
+		if (m_Tracer.enabled())
+		{
+			traceId           = m_Tracer.nextId();
+			job.m_CreatedTime = Clock::now();
+		}
+		job.m_TraceId.store(traceId, std::memory_order_release);
+		counters().m_JobsCreated.fetch_add(1, std::memory_order_relaxed);
+		// The extra count keeps the job from being readied by a finishing dependency while we are still registering it, holds keep it back until signaled
+		job.m_ReadyCounter.store(dependencies.size() + holds + 1, std::memory_order_relaxed);
+		++m_JobsLeft;
+
+		std::size_t done = 1;
+		for (auto& dependency : dependencies)
+		{
+			if (!dependency.valid())
 			{
-				m_JobMutex.unlock();
-				std::uint64_t expected = m_JobAtomic.load();
-				m_JobAtomic.wait(expected);
+				++done;
 				continue;
 			}
-			job->m_Taken = true;
-			m_JobMutex.unlock();
-			--m_JobsLeft;
 
-			try
-			{
-				job->m_Func({ this, job });
-			}
-			catch (const Utils::Exception& exception)
-			{
-				Log::GetOrCreateLogger(exception.title())->critical("{}", exception);
-			}
-			catch (const std::exception& exception)
+			auto&         dependencyJob = m_Jobs[dependency.m_Index];
+			std::uint64_t state         = dependencyJob.m_State.load(std::memory_order_acquire);
+			if (Job::StateGeneration(state) != dependency.m_Generation || Job::StateContinuations(state) == Job::c_Finished)
 			{
-				auto& backtrace = Utils::LastBackTrace();
-				if (backtrace.frames().empty())
-					Log::Critical("{}", exception.what());
-				else
-					Log::Critical("{}\n{}", exception.what(), backtrace);
+				++done;
+				continue;
 			}
-			catch (...)
+
+			// Read before pushing, a recycled slot's new id can't be seen while the push still succeeds
+			std::uint64_t dependencyTraceId     = traceId ? dependencyJob.m_TraceId.load(std::memory_order_acquire) : 0;
+			std::uint32_t continuation          = m_Continuations.allocate();
+			m_Continuations[continuation].m_Job = index;
+			while (true)
 			{
-				auto& backtrace = Utils::LastBackTrace();
-				if (backtrace.frames().empty())
-					Log::Critical("Uncaught exception occurred");
-				else
-					Log::Critical("Uncaught exception occurred\n{}", backtrace);
+				if (Job::StateGeneration(state) != dependency.m_Generation || Job::StateContinuations(state) == Job::c_Finished)
+				{
+					m_Continuations.free(continuation);
+					++done;
+					break;
+				}
+
+				m_Continuations[continuation].m_Next = Job::StateContinuations(state);
+				if (dependencyJob.m_State.compare_exchange_weak(state, Job::PackState(dependency.m_Generation, continuation), std::memory_order_release, std::memory_order_acquire))
+				{
+					if (dependencyTraceId)
+						traceBuffer().m_Edges.emplace_back(JobTracer::Edge { dependencyTraceId, traceId });
+					break;
+				}
 			}
-			job->m_Done = true;
-			job->m_Done.notify_all();
-			for (auto& signal : job->m_Signals)
+		}
+		if (job.m_ReadyCounter.fetch_sub(done) == done)
+		{
+			readyJob(&job);
+			wakeWorkers(1);
+		}
+		return { this, index, generation };
+	}
+
+	bool JobSystem::isJobDone(JobRef job)
+	{
+		// Sequentially consistent to pair with finishJob checking for sleeping helpers
+		std::uint64_t state = m_Jobs[job.m_Index].m_State.load(std::memory_order_seq_cst);
+		return Job::StateGeneration(state) != job.m_Generation || Job::StateContinuations(state) == Job::c_Finished;
+	}
+
+	bool JobSystem::isDependencyFailed(JobRef job)
+	{
+		return m_Jobs[job.m_Index].m_Failed.load(std::memory_order_relaxed);
+	}
+
+	bool JobSystem::isJobCancelled(JobRef job)
+	{
+		return m_Jobs[job.m_Index].m_Token.cancelled();
+	}
+
+	std::pmr::memory_resource* JobSystem::scratch()
+	{
+		Worker* worker = tl_CurrentWorker && tl_CurrentWorker->m_JobSystem == this ? tl_CurrentWorker : nullptr;
+		return worker && worker->m_JobDepth > 0 ? static_cast<std::pmr::memory_resource*>(&worker->m_Scratch) : std::pmr::new_delete_resource();
+	}
+
+	void JobSystem::SafeThreadFunc(Worker* worker)
+	{
+		if (worker->m_Pinned && !PinCurrentThread(worker->m_Core))
+			Log::Warn("Failed to pin job system worker to processor {}:{}", worker->m_Core.group, worker->m_Core.index);
+
+		tl_CurrentWorker = worker;
+		while (m_Alive)
+		{
+			auto job = getNextJob(worker);
+			if (job == nullptr)
 			{
-				if (--signal.m_Job->m_ReadyCounter == 0)
+				// Announce that we are about to sleep before the final check, wakeWorkers skips notifying when nobody sleeps
+				++m_Sleepers;
+				std::uint64_t expected = m_JobAtomic.load();
+				job                    = getNextJob(worker);
+				if (job == nullptr && m_Alive)
 				{
-					m_JobAtomic.fetch_add(1);
-					m_JobAtomic.notify_one();
+					// Sleeping since before tracing started counts from the start of the trace
+					auto         idleBegin      = Clock::now();
+					std::int64_t traceIdleBegin = m_Tracer.enabled() ? m_Tracer.since(idleBegin) : 0;
+					m_JobAtomic.wait(expected);
+					auto idleEnd = Clock::now();
+					worker->m_Counters.m_IdleTime.fetch_add(Nanoseconds(idleEnd - idleBegin), std::memory_order_relaxed);
+					if (m_Tracer.enabled())
+						traceBuffer().m_Events.emplace_back(JobTracer::Event { ETraceEventType::Idle, 0, traceIdleBegin, m_Tracer.since(idleEnd), 0, 0, {} });
 				}
+				--m_Sleepers;
+				if (job == nullptr)
+					continue;
 			}
-			if (job->m_Refs == 0)
-				killJob({ this, job });
+			runJob(job);
 		}
+		tl_CurrentWorker = nullptr;
 	}
 
-	void JobSystem::ThreadFunc()
+	void JobSystem::ThreadFunc(Worker* worker)
 	{
 		//Log::Trace("Job System worker was ressurected from the shadow realm");
 		try
 		{
 			Utils::HookThrow();
-			SafeThreadFunc();
+			SafeThreadFunc(worker);
 		}
 		catch (const Utils::Exception& exception)
 		{
@@ -177,11 +382,307 @@ namespace JobSystem
 		//Log::Trace("Job System worker died of unnatural causes");
 	}
 
-	Job* JobSystem::getNextJob()
+	void JobSystem::runJob(Job* job)
 	{
-		for (auto& job : m_Jobs)
-			if (!job->m_Done && !job->m_Taken && job->m_ReadyCounter == 0)
-				return job.get();
+		--m_JobsLeft;
+		m_ReadyDepth.fetch_sub(1, std::memory_order_relaxed);
+
+		auto          start      = Clock::now();
+		std::uint64_t traceId    = job->m_TraceId.load(std::memory_order_relaxed);
+		std::int64_t  traceBegin = traceId ? m_Tracer.since(start) : 0;
+		auto&         counters   = this->counters();
+		std::uint64_t latency    = Nanoseconds(start - job->m_ReadyTime);
+		counters.m_ReadyLatencyTotal.fetch_add(latency, std::memory_order_relaxed);
+		AtomicMax(counters.m_ReadyLatencyMax, latency);
+
+		// The failing dependency's ready count release orders its m_Failed store before our load
+		bool failed = !job->m_AlwaysRun && (job->m_Failed.load(std::memory_order_relaxed) || job->m_Token.cancelled());
+		bool ran    = !failed && job->m_Func;
+
+		Worker* worker = tl_CurrentWorker && tl_CurrentWorker->m_JobSystem == this ? tl_CurrentWorker : nullptr;
+		if (worker)
+			++worker->m_JobDepth;
+		try
+		{
+			if (ran)
+				job->m_Func({ this, job->m_Index, Job::StateGeneration(job->m_State.load(std::memory_order_relaxed)) });
+		}
+		catch (const Utils::Exception& exception)
+		{
+			failed = true;
+			Log::GetOrCreateLogger(exception.title())->critical("{}", exception);
+		}
+		catch (const std::exception& exception)
+		{
+			failed          = true;
+			auto& backtrace = Utils::LastBackTrace();
+			if (backtrace.frames().empty())
+				Log::Critical("{}", exception.what());
+			else
+				Log::Critical("{}\n{}", exception.what(), backtrace);
+		}
+		catch (...)
+		{
+			failed          = true;
+			auto& backtrace = Utils::LastBackTrace();
+			if (backtrace.frames().empty())
+				Log::Critical("Uncaught exception occurred");
+			else
+				Log::Critical("Uncaught exception occurred\n{}", backtrace);
+		}
+		if (worker && --worker->m_JobDepth == 0)
+			worker->m_Scratch.release();
+		// Fail fast, everything else sharing the token is skipped from now on
+		if (failed)
+		{
+			job->m_Token.cancel();
+			counters.m_JobsFailed.fetch_add(1, std::memory_order_relaxed);
+		}
+		// Skipped jobs would only teach the cost model that they are free
+		if (ran && m_CostModel && !job->m_Name.empty())
+			m_CostModel->record(job->m_Name, std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+		if (traceId)
+			traceBuffer().m_Events.emplace_back(JobTracer::Event { ETraceEventType::Job, traceId, traceBegin, m_Tracer.now(), m_Tracer.since(job->m_CreatedTime), m_Tracer.since(job->m_ReadyTime), job->m_Name });
+		finishJob(job, failed);
+		counters.m_JobsCompleted.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Job* JobSystem::getNextJob(Worker* worker)
+	{
+		for (std::size_t priority = 0; priority < c_JobPriorityCount; ++priority)
+		{
+			Job* job = nullptr;
+			if (worker && worker->m_ReadyJobs[priority].pop(job))
+				return job;
+
+			if (m_ReadyJobCount > 0)
+			{
+				QueueLock lock { this };
+				auto&     readyJobs = m_ReadyJobs[priority];
+				if (!readyJobs.empty())
+				{
+					std::pop_heap(readyJobs.begin(), readyJobs.end());
+					job = readyJobs.back().m_Job;
+					readyJobs.pop_back();
+					--m_ReadyJobCount;
+					return job;
+				}
+			}
+
+			job = stealJob(worker, priority);
+			if (job)
+				return job;
+		}
+		return nullptr;
+	}
+
+	Job* JobSystem::stealJob(Worker* worker, std::size_t priority)
+	{
+		// Start at a random victim so idle workers don't all hammer the same deque
+		std::size_t    count = m_Workers.size();
+		std::uint32_t& seed  = worker ? worker->m_Seed : tl_StealSeed;
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		std::size_t start = seed % count;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			auto victim = m_Workers[(start + i) % count].get();
+			if (victim == worker)
+				continue;
+
+			// Empty deques aren't worth counting as attempts
+			if (victim->m_ReadyJobs[priority].empty())
+				continue;
+
+			auto& counters = this->counters();
+			counters.m_StealAttempts.fetch_add(1, std::memory_order_relaxed);
+			Job* job = nullptr;
+			if (victim->m_ReadyJobs[priority].steal(job))
+			{
+				counters.m_Steals.fetch_add(1, std::memory_order_relaxed);
+				return job;
+			}
+		}
 		return nullptr;
 	}
+
+	void JobSystem::readyJob(Job* job)
+	{
+		auto now         = Clock::now();
+		job->m_ReadyTime = now;
+
+		std::size_t depth = m_ReadyDepth.fetch_add(1, std::memory_order_relaxed) + 1;
+		AtomicMax(m_MaxReadyDepth, depth);
+		std::int64_t time       = static_cast<std::int64_t>(Nanoseconds(now - m_StartTime));
+		std::int64_t lastSample = m_LastDepthSample.load(std::memory_order_relaxed);
+		if (time - lastSample >= c_DepthSampleInterval && m_LastDepthSample.compare_exchange_strong(lastSample, time, std::memory_order_relaxed))
+		{
+			std::lock_guard lock { m_DepthSamplesMutex };
+			m_DepthSamples.emplace_back(QueueDepthSample { static_cast<std::uint64_t>(time), depth });
+		}
+
+		auto priority = static_cast<std::size_t>(job->m_Priority);
+		// Critical path order is global, so ranked jobs skip the worker deques
+		if (!m_CostModel && tl_CurrentWorker && tl_CurrentWorker->m_JobSystem == this)
+		{
+			tl_CurrentWorker->m_ReadyJobs[priority].push(job);
+			return;
+		}
+
+		QueueLock lock { this };
+		auto&     readyJobs = m_ReadyJobs[priority];
+		readyJobs.emplace_back(ReadyJob { job->m_Rank.load(std::memory_order_relaxed), m_ReadySequence++, job });
+		std::push_heap(readyJobs.begin(), readyJobs.end());
+		++m_ReadyJobCount;
+	}
+
+	void JobSystem::rankJob(Job* job, const std::vector<JobRef>& dependencies)
+	{
+		std::uint64_t cost = m_CostModel->estimate(job->m_Name);
+
+		// Raise the rank of every unfinished job upstream, ranks of jobs that are already ready stay as they were queued
+		std::lock_guard lock { m_RankMutex };
+		job->m_Cost = cost;
+		job->m_Rank.store(cost, std::memory_order_relaxed);
+		job->m_Dependencies.clear();
+		for (auto& dependency : dependencies)
+			if (dependency.valid() && dependency.m_JobSystem == this)
+				job->m_Dependencies.emplace_back(dependency);
+
+		std::vector<Job*> stack { job };
+		while (!stack.empty())
+		{
+			Job* current = stack.back();
+			stack.pop_back();
+			std::uint64_t rank = current->m_Rank.load(std::memory_order_relaxed);
+			for (auto& dependency : current->m_Dependencies)
+			{
+				if (isJobDone(dependency))
+					continue;
+
+				auto&         dependencyJob = m_Jobs[dependency.m_Index];
+				std::uint64_t newRank       = dependencyJob.m_Cost + rank;
+				if (newRank <= dependencyJob.m_Rank.load(std::memory_order_relaxed))
+					continue;
+				dependencyJob.m_Rank.store(newRank, std::memory_order_relaxed);
+				stack.emplace_back(&dependencyJob);
+			}
+		}
+	}
+
+	void JobSystem::finishJob(Job* job, bool failed)
+	{
+		job->m_Func  = nullptr;
+		job->m_Token = {};
+		if (m_CostModel)
+		{
+			std::lock_guard lock { m_RankMutex };
+			job->m_Dependencies.clear();
+		}
+
+		// Closing the list hands us every continuation pushed so far and makes later createJob calls see the job as done
+		std::uint32_t generation = Job::StateGeneration(job->m_State.load(std::memory_order_relaxed));
+		std::uint64_t state      = job->m_State.exchange(Job::PackState(generation, Job::c_Finished), std::memory_order_seq_cst);
+		job->m_State.notify_all();
+		if (m_Helpers > 0)
+		{
+			m_JobAtomic.fetch_add(1);
+			m_JobAtomic.notify_all();
+		}
+
+		std::size_t readied = 0;
+		for (std::uint32_t continuation = Job::StateContinuations(state); continuation != Job::c_NoContinuations;)
+		{
+			auto& node      = m_Continuations[continuation];
+			auto& dependent = m_Jobs[node.m_Job];
+			if (failed)
+				dependent.m_Failed.store(true, std::memory_order_relaxed);
+			if (--dependent.m_ReadyCounter == 0)
+			{
+				readyJob(&dependent);
+				++readied;
+			}
+			std::uint32_t next = node.m_Next;
+			m_Continuations.free(continuation);
+			continuation = next;
+		}
+		wakeWorkers(readied);
+
+		job->m_State.store(Job::PackState(generation + 1, Job::c_NoContinuations), std::memory_order_release);
+		m_Jobs.free(job->m_Index);
+	}
+
+	void JobSystem::wakeWorkers(std::size_t count)
+	{
+		if (count == 0)
+			return;
+
+		m_JobAtomic.fetch_add(1);
+		std::size_t sleepers = m_Sleepers.load();
+		if (sleepers == 0)
+			return;
+
+		if (count >= sleepers)
+		{
+			m_JobAtomic.notify_all();
+		}
+		else
+		{
+			for (std::size_t i = 0; i < count; ++i)
+				m_JobAtomic.notify_one();
+		}
+	}
+
+	JobTracer::Buffer& JobSystem::traceBuffer()
+	{
+		auto& buffer = m_Tracer.threadBuffer();
+		if (buffer.m_ThreadName.empty() && tl_CurrentWorker && tl_CurrentWorker->m_JobSystem == this)
+			buffer.m_ThreadName = "Worker " + std::to_string(tl_CurrentWorker->m_Index);
+		return buffer;
+	}
+
+	JobSystem::Counters& JobSystem::counters()
+	{
+		return tl_CurrentWorker && tl_CurrentWorker->m_JobSystem == this ? tl_CurrentWorker->m_Counters : m_ExternalCounters;
+	}
+
+	JobSystemStats JobSystem::stats() const
+	{
+		JobSystemStats stats {};
+		stats.threadCount = m_Workers.size();
+		stats.uptime      = Nanoseconds(Clock::now() - m_StartTime);
+
+		auto add = [&stats](const Counters& counters)
+		{
+			stats.jobsCreated           += counters.m_JobsCreated.load(std::memory_order_relaxed);
+			stats.jobsCompleted         += counters.m_JobsCompleted.load(std::memory_order_relaxed);
+			stats.jobsFailed            += counters.m_JobsFailed.load(std::memory_order_relaxed);
+			stats.stealAttempts         += counters.m_StealAttempts.load(std::memory_order_relaxed);
+			stats.steals                += counters.m_Steals.load(std::memory_order_relaxed);
+			stats.idleTime              += counters.m_IdleTime.load(std::memory_order_relaxed);
+			stats.queueLockAcquisitions += counters.m_QueueLockAcquisitions.load(std::memory_order_relaxed);
+			stats.queueLockHeldTime     += counters.m_QueueLockHeldTime.load(std::memory_order_relaxed);
+			stats.readyLatencyTotal     += counters.m_ReadyLatencyTotal.load(std::memory_order_relaxed);
+			stats.readyLatencyMax        = std::max(stats.readyLatencyMax, counters.m_ReadyLatencyMax.load(std::memory_order_relaxed));
+		};
+		for (auto& worker : m_Workers)
+			add(worker->m_Counters);
+		add(m_ExternalCounters);
+
+		stats.maxQueueDepth = m_MaxReadyDepth.load(std::memory_order_relaxed);
+		std::lock_guard lock { m_DepthSamplesMutex };
+		stats.queueDepth = m_DepthSamples;
+		return stats;
+	}
+
+	JobSystem::QueueLock::QueueLock(JobSystem* jobSystem)
+	    : m_JobSystem(jobSystem), m_Lock(jobSystem->m_ReadyJobMutex), m_Acquired(Clock::now()) {}
+
+	JobSystem::QueueLock::~QueueLock()
+	{
+		auto& counters = m_JobSystem->counters();
+		counters.m_QueueLockAcquisitions.fetch_add(1, std::memory_order_relaxed);
+		counters.m_QueueLockHeldTime.fetch_add(Nanoseconds(Clock::now() - m_Acquired), std::memory_order_relaxed);
+	}
 } // namespace JobSystem
\ No newline at end of file
@@ -1,73 +1,267 @@
 #pragma once
 
+#include "Cancellation.h"
+#include "JobCostModel.h"
+#include "Pool.h"
+#include "Stats.h"
+#include "Topology.h"
+#include "Trace.h"
+#include "Utils/InplaceFunction.h"
+#include "WorkStealingDeque.h"
+
+#include <array>
 #include <atomic>
-#include <functional>
+#include <chrono>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <string>
+#include <string_view>
 #include <thread>
 #include <vector>
 
 namespace JobSystem
 {
 	class JobSystem;
+	class JobGraph;
 	struct Job;
 
+	// Ready jobs of a higher priority always run before ready jobs of a lower priority
+	enum class EJobPriority : std::uint8_t
+	{
+		High = 0,
+		Normal,
+		Low
+	};
+
+	static constexpr std::size_t c_JobPriorityCount = 3;
+
+	// Handle to a pooled job, the job is finished once it closed its continuation list or the slot's generation no longer matches
 	struct JobRef
 	{
 	public:
-		JobRef() : m_JobSystem(nullptr), m_Job(nullptr) {}
-		JobRef(JobSystem* jobSystem, Job* job);
-		~JobRef();
+		JobRef() : m_JobSystem(nullptr), m_Index(0), m_Generation(0) {}
+		JobRef(JobSystem* jobSystem, std::uint32_t index, std::uint32_t generation) : m_JobSystem(jobSystem), m_Index(index), m_Generation(generation) {}
+
+		bool valid() const { return m_JobSystem != nullptr; }
+		bool done() const;
 
 		void reset();
 
-		JobSystem* m_JobSystem;
-		Job*       m_Job;
+		// Only meaningful for the running job, continuations check whether anything they waited on failed
+		bool dependencyFailed() const;
+		// Long running jobs poll this to stop early once their token was cancelled
+		bool cancelled() const;
+		// Scratch memory of the thread running the job, see JobSystem::scratch
+		std::pmr::memory_resource* scratch() const;
+
+		JobSystem*    m_JobSystem;
+		std::uint32_t m_Index;
+		std::uint32_t m_Generation;
 	};
 
 	struct Job
 	{
 	public:
-		using Func = std::function<void(JobRef currentJob)>;
+		// Captures larger than this fail to compile, share big immutable state by reference instead of copying it into every job
+		static constexpr std::size_t c_FuncCapacity = 64;
+
+		using Func = Utils::InplaceFunction<void(JobRef currentJob), c_FuncCapacity>;
+
+		static constexpr std::uint32_t c_NoContinuations = ~0U;
+		static constexpr std::uint32_t c_Finished        = ~0U - 1;
+
+		static constexpr std::uint64_t PackState(std::uint32_t generation, std::uint32_t continuations) { return static_cast<std::uint64_t>(generation) << 32 | continuations; }
+		static constexpr std::uint32_t StateGeneration(std::uint64_t state) { return static_cast<std::uint32_t>(state >> 32); }
+		static constexpr std::uint32_t StateContinuations(std::uint64_t state) { return static_cast<std::uint32_t>(state); }
 
 	public:
-		Job(Func&& func, std::size_t readyCounter) : m_Func(std::move(func)), m_ReadyCounter(readyCounter) {}
+		Func          m_Func;
+		std::uint32_t m_Index    = 0;
+		EJobPriority  m_Priority = EJobPriority::Normal;
+		std::string   m_Name;
+		// Upper half is the slot generation, lower half the head of the continuation list or c_Finished once the job ran
+		// Both live in one word so a continuation can never be pushed onto a job that already finished or onto a recycled slot
+		std::atomic_uint64_t m_State        = PackState(0, c_NoContinuations);
+		std::atomic_size_t   m_ReadyCounter = 0;
+
+		// Set by a failing dependency before it releases its ready count, the job is then skipped and fails in turn
+		std::atomic_bool  m_Failed    = false;
+		bool              m_AlwaysRun = false;
+		CancellationToken m_Token;
+
+		// Critical path scheduling only, the rank is the estimated cost of the longest chain of jobs waiting on this one
+		std::uint64_t        m_Cost = 0;
+		std::atomic_uint64_t m_Rank = 0;
+		std::vector<JobRef>  m_Dependencies;
 
-		Func                m_Func;
-		std::size_t         m_ReadyCounter;
-		std::vector<JobRef> m_Signals;
+		std::chrono::steady_clock::time_point m_ReadyTime;
 
-		bool             m_Taken = false;
-		std::atomic_bool m_Done  = false;
-		std::size_t      m_Refs  = 0;
+		// Tracing only, jobs created while tracing is off keep id 0 and aren't recorded
+		std::atomic_uint64_t                  m_TraceId = 0;
+		std::chrono::steady_clock::time_point m_CreatedTime;
 	};
 
 	class JobSystem
 	{
 	public:
-		JobSystem(std::size_t numThreads);
+		// numThreads == 0 sizes the pool from the CPUs and CPU quota available to the process
+		// A cost model enables critical path scheduling, ready jobs are ordered by the estimated cost of everything still waiting on them and named jobs record their run time into the model
+		JobSystem(std::size_t numThreads = 0, bool pinThreads = false, JobCostModel* costModel = nullptr);
 		~JobSystem();
 
-		void waitForJob(JobRef job);
+		std::size_t threadCount() const { return m_Workers.size(); }
+
+		// Helping runs ready jobs on the waiting thread until the job finished, so waiting inside a job neither idles a core nor deadlocks once every worker waits
+		// Don't help while holding locks other jobs may take
+		void waitForJob(JobRef job, bool help = true);
 
 		void kill();
-		void killJob(JobRef job);
 
-		JobRef createJob(Job::Func&& func, const std::vector<JobRef>& dependencies);
+		// A job fails when it throws, when a dependency failed or when its token was cancelled before it started
+		// Failed jobs are skipped, cancel their token and fail every job depending on them, jobs created after the failed one finished can't tell
+		// Use a token to find out whether any job of a group failed
+		JobRef createJob(Job::Func&& func, const std::vector<JobRef>& dependencies, EJobPriority priority = EJobPriority::Normal, std::string_view name = {}, CancellationToken token = {});
+		// Runs once every dependency finished even if some failed, check currentJob.dependencyFailed()
+		JobRef createContinuation(Job::Func&& func, const std::vector<JobRef>& dependencies, EJobPriority priority = EJobPriority::Normal, std::string_view name = {});
+		// An event is an empty job that only finishes once signaled, jobs may depend on it like on any other job
+		// Signal exactly once, the ref stays valid until then, signaling a failure fails everything depending on the event
+		JobRef createEvent();
+		void   signalEvent(JobRef event, bool failed = false);
+		// Creates every job of the graph before any of them may start, then wakes one worker per ready job
+		// Returns the created jobs indexed by graph node, throws if the graph has a cycle
+		std::vector<JobRef> submit(JobGraph&& graph);
+
+		bool isJobDone(JobRef job);
+		// Only valid while the job runs
+		bool isDependencyFailed(JobRef job);
+		bool isJobCancelled(JobRef job);
+
+		// Bump allocator of the calling worker, everything allocated from it is released at once when the worker's outermost job returns
+		// Don't keep scratch memory past the job or across a co_await, and only grow containers using it from the thread that created them
+		// Threads outside the job system get the global allocator
+		std::pmr::memory_resource* scratch();
+
+		JobSystemStats stats() const;
+
+		// Records every job created from now on, writeTrace dumps them as a Chrome trace once the job system was killed
+		void startTracing() { m_Tracer.start(); }
+		bool writeTrace(const std::filesystem::path& path) const { return m_Tracer.write(path); }
+
+	private:
+		// Fits most SDK headers, bigger scratch needs spill into the global allocator until the release
+		static constexpr std::size_t c_ScratchSize = 2 << 20;
+
+		struct Continuation
+		{
+		public:
+			std::uint32_t m_Job  = 0;
+			std::uint32_t m_Next = Job::c_NoContinuations;
+		};
+
+		struct ReadyJob
+		{
+		public:
+			std::uint64_t m_Rank;
+			std::uint64_t m_Sequence;
+			Job*          m_Job;
+
+			// Max heap on rank, first readied first for equal ranks
+			bool operator<(const ReadyJob& other) const { return m_Rank != other.m_Rank ? m_Rank < other.m_Rank : m_Sequence > other.m_Sequence; }
+		};
+
+		struct Counters
+		{
+		public:
+			std::atomic_uint64_t m_JobsCreated           = 0;
+			std::atomic_uint64_t m_JobsCompleted         = 0;
+			std::atomic_uint64_t m_JobsFailed            = 0;
+			std::atomic_uint64_t m_StealAttempts         = 0;
+			std::atomic_uint64_t m_Steals                = 0;
+			std::atomic_uint64_t m_IdleTime              = 0;
+			std::atomic_uint64_t m_QueueLockAcquisitions = 0;
+			std::atomic_uint64_t m_QueueLockHeldTime     = 0;
+			std::atomic_uint64_t m_ReadyLatencyTotal     = 0;
+			std::atomic_uint64_t m_ReadyLatencyMax       = 0;
+		};
+
+		// Holds m_ReadyJobMutex and accounts for how long it was held
+		class QueueLock
+		{
+		public:
+			QueueLock(JobSystem* jobSystem);
+			~QueueLock();
+
+		private:
+			JobSystem*                            m_JobSystem;
+			std::unique_lock<std::mutex>          m_Lock;
+			std::chrono::steady_clock::time_point m_Acquired;
+		};
+
+		struct Worker
+		{
+		public:
+			JobSystem*                                              m_JobSystem;
+			std::array<WorkStealingDeque<Job*>, c_JobPriorityCount> m_ReadyJobs;
+			std::thread                                             m_Thread;
+			std::uint32_t                                           m_Index;
+			std::uint32_t                                           m_Seed;
+			bool                                                    m_Pinned;
+			ProcessorCore                                           m_Core;
+			Counters                                                m_Counters;
+			// Jobs nest while waiting jobs help, so scratch is only released once the outermost one returns
+			std::uint32_t                                           m_JobDepth = 0;
+			std::unique_ptr<std::byte[]>                            m_ScratchBuffer = std::make_unique_for_overwrite<std::byte[]>(c_ScratchSize);
+			std::pmr::monotonic_buffer_resource                     m_Scratch { m_ScratchBuffer.get(), c_ScratchSize };
+		};
 
 	private:
-		void SafeThreadFunc();
-		void ThreadFunc();
+		void SafeThreadFunc(Worker* worker);
+		void ThreadFunc(Worker* worker);
 
-		Job* getNextJob();
+		JobRef addJob(Job::Func&& func, const std::vector<JobRef>& dependencies, EJobPriority priority, std::string_view name, std::size_t holds, bool alwaysRun, CancellationToken token);
+		void   runJob(Job* job);
+		Job* getNextJob(Worker* worker);
+		Job* stealJob(Worker* worker, std::size_t priority);
+		void readyJob(Job* job);
+		void rankJob(Job* job, const std::vector<JobRef>& dependencies);
+		void finishJob(Job* job, bool failed);
+		void wakeWorkers(std::size_t count);
+
+		JobTracer::Buffer& traceBuffer();
+		Counters&          counters();
 
 	private:
-		std::atomic_uint64_t              m_JobsLeft = 0;
-		std::vector<std::unique_ptr<Job>> m_Jobs;
-		std::atomic_uint64_t              m_JobAtomic;
-		std::mutex                        m_JobMutex;
+		std::atomic_uint64_t     m_JobsLeft = 0;
+		Pool<Job>                m_Jobs;
+		Pool<Continuation, 1024> m_Continuations;
+
+		// Jobs readied from threads outside the job system, or every ready job when scheduling by critical path
+		std::array<std::vector<ReadyJob>, c_JobPriorityCount> m_ReadyJobs;
+		std::uint64_t                                         m_ReadySequence = 0;
+		std::atomic_size_t                                    m_ReadyJobCount = 0;
+		std::mutex                                            m_ReadyJobMutex;
+
+		JobCostModel* m_CostModel;
+		std::mutex    m_RankMutex;
+
+		JobTracer m_Tracer;
+
+		std::chrono::steady_clock::time_point m_StartTime;
+		Counters                              m_ExternalCounters;
+		std::atomic_size_t                    m_ReadyDepth    = 0;
+		std::atomic_size_t                    m_MaxReadyDepth = 0;
+		std::atomic_int64_t                   m_LastDepthSample;
+		std::vector<QueueDepthSample>         m_DepthSamples;
+		mutable std::mutex                    m_DepthSamplesMutex;
+
+		std::vector<std::unique_ptr<Worker>> m_Workers;
+		std::atomic_uint64_t                 m_JobAtomic;
+		std::atomic_size_t                   m_Sleepers = 0;
+		std::atomic_size_t                   m_Helpers  = 0;
+		std::atomic_bool                     m_Alive;
 
-		std::vector<std::thread> m_Threads;
-		std::atomic_bool         m_Alive;
+		static thread_local Worker*       tl_CurrentWorker;
+		static thread_local std::uint32_t tl_StealSeed;
 	};
 } // namespace JobSystem
\ No newline at end of file
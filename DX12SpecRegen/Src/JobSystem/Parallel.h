@@ -0,0 +1,140 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace JobSystem
+{
+	namespace Details
+	{
+		// A few chunks per worker so uneven iterations still balance out
+		inline std::size_t AutoGrainSize(std::size_t count, std::size_t threadCount)
+		{
+			std::size_t chunks = std::max<std::size_t>(threadCount, 1) * 4;
+			return std::max<std::size_t>((count + chunks - 1) / chunks, 1);
+		}
+
+		template <class Func>
+		struct ParallelForState
+		{
+		public:
+			// Late helper jobs only touch the counters, func lives on the caller's stack and is gone once every chunk is done
+			void run()
+			{
+				std::size_t chunk;
+				while ((chunk = m_Next.fetch_add(1)) < m_Chunks)
+				{
+					try
+					{
+						std::size_t first = m_Begin + chunk * m_GrainSize;
+						std::size_t last  = std::min(first + m_GrainSize, m_End);
+						for (std::size_t i = first; i < last; ++i)
+							(*m_Func)(i);
+					}
+					catch (...)
+					{
+						std::lock_guard lock { m_ExceptionMutex };
+						if (!m_Exception)
+							m_Exception = std::current_exception();
+					}
+					if (m_Done.fetch_add(1) + 1 == m_Chunks)
+						m_Done.notify_all();
+				}
+			}
+
+		public:
+			Func*              m_Func;
+			std::size_t        m_Begin;
+			std::size_t        m_End;
+			std::size_t        m_GrainSize;
+			std::size_t        m_Chunks;
+			std::atomic_size_t m_Next = 0;
+			std::atomic_size_t m_Done = 0;
+			std::mutex         m_ExceptionMutex;
+			std::exception_ptr m_Exception;
+		};
+	} // namespace Details
+
+	// Calls func(i) for every i in [begin, end), chunks of grainSize iterations run on idle workers and the calling thread
+	// The caller only ever runs its own chunks, so it is safe to call from inside a job, grainSize == 0 picks one from the worker count
+	// Rethrows the first exception thrown by func once every chunk finished
+	template <class Func>
+	void ParallelFor(JobSystem& jobSystem, std::size_t begin, std::size_t end, Func&& func, std::size_t grainSize = 0)
+	{
+		if (begin >= end)
+			return;
+
+		std::size_t count = end - begin;
+		if (grainSize == 0)
+			grainSize = Details::AutoGrainSize(count, jobSystem.threadCount());
+		std::size_t chunks = (count + grainSize - 1) / grainSize;
+		if (chunks <= 1 || jobSystem.threadCount() == 0)
+		{
+			for (std::size_t i = begin; i < end; ++i)
+				func(i);
+			return;
+		}
+
+		using State = Details::ParallelForState<std::remove_reference_t<Func>>;
+		auto state         = std::make_shared<State>();
+		state->m_Func      = &func;
+		state->m_Begin     = begin;
+		state->m_End       = end;
+		state->m_GrainSize = grainSize;
+		state->m_Chunks    = chunks;
+
+		std::size_t helpers = std::min(chunks - 1, jobSystem.threadCount());
+		for (std::size_t i = 0; i < helpers; ++i)
+			jobSystem.createJob([state](JobRef) { state->run(); }, {}, EJobPriority::High);
+		state->run();
+
+		// Whatever is left is running on other workers right now
+		std::size_t done;
+		while ((done = state->m_Done.load()) < chunks)
+			state->m_Done.wait(done);
+
+		if (state->m_Exception)
+			std::rethrow_exception(state->m_Exception);
+	}
+
+	// Folds map(i) for every i in [begin, end) with reduce, starting every chunk from identity
+	// Partial results are combined in index order, so reduce only has to be associative
+	template <class T, class Map, class Reduce>
+	T ParallelReduce(JobSystem& jobSystem, std::size_t begin, std::size_t end, T identity, Map&& map, Reduce&& reduce, std::size_t grainSize = 0)
+	{
+		if (begin >= end)
+			return identity;
+
+		std::size_t count = end - begin;
+		if (grainSize == 0)
+			grainSize = Details::AutoGrainSize(count, jobSystem.threadCount());
+		std::size_t chunks = (count + grainSize - 1) / grainSize;
+
+		std::vector<T> partials(chunks, identity);
+		ParallelFor(
+		    jobSystem,
+		    0,
+		    chunks,
+		    [&](std::size_t chunk)
+		    {
+			    std::size_t first = begin + chunk * grainSize;
+			    std::size_t last  = std::min(first + grainSize, end);
+			    T&          value = partials[chunk];
+			    for (std::size_t i = first; i < last; ++i)
+				    value = reduce(std::move(value), map(i));
+		    },
+		    1);
+
+		T result = std::move(identity);
+		for (auto& partial : partials)
+			result = reduce(std::move(result), std::move(partial));
+		return result;
+	}
+} // namespace JobSystem
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Utils/Exception.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace JobSystem
+{
+	// Index addressed object pool, objects live in fixed size slabs that are never freed or moved until the pool is destroyed
+	// allocate and free are lock-free unless a new slab has to be created
+	template <class T, std::uint32_t SlabSize = 256, std::uint32_t MaxSlabs = 16384>
+	class Pool
+	{
+	public:
+		static constexpr std::uint32_t c_InvalidIndex = ~0U;
+
+	public:
+		Pool() : m_FreeHead(Pack(0, c_InvalidIndex)), m_SlabCount(0) {}
+
+		Pool(const Pool&) = delete;
+		Pool(Pool&&)      = delete;
+		Pool& operator=(const Pool&) = delete;
+		Pool& operator=(Pool&&) = delete;
+
+		std::uint32_t allocate()
+		{
+			while (true)
+			{
+				std::uint64_t head = m_FreeHead.load(std::memory_order_acquire);
+				while (Index(head) != c_InvalidIndex)
+				{
+					// The slot may be handed out and freed again between the load and the CAS, the tag makes the CAS fail in that case
+					std::uint32_t next = slot(Index(head)).m_NextFree.load(std::memory_order_relaxed);
+					if (m_FreeHead.compare_exchange_weak(head, Pack(Tag(head) + 1, next), std::memory_order_acq_rel, std::memory_order_acquire))
+						return Index(head);
+				}
+
+				std::uint32_t index = grow();
+				if (index != c_InvalidIndex)
+					return index;
+			}
+		}
+
+		void free(std::uint32_t index)
+		{
+			pushFree(index, index);
+		}
+
+		T&       operator[](std::uint32_t index) { return slot(index).m_Value; }
+		const T& operator[](std::uint32_t index) const { return slot(index).m_Value; }
+
+		std::uint32_t capacity() const { return m_SlabCount.load(std::memory_order_acquire) * SlabSize; }
+
+	private:
+		struct Slot
+		{
+		public:
+			T                    m_Value;
+			std::atomic_uint32_t m_NextFree = c_InvalidIndex;
+		};
+
+		static constexpr std::uint64_t Pack(std::uint32_t tag, std::uint32_t index) { return static_cast<std::uint64_t>(tag) << 32 | index; }
+		static constexpr std::uint32_t Tag(std::uint64_t head) { return static_cast<std::uint32_t>(head >> 32); }
+		static constexpr std::uint32_t Index(std::uint64_t head) { return static_cast<std::uint32_t>(head); }
+
+		Slot&       slot(std::uint32_t index) { return m_Slabs[index / SlabSize][index % SlabSize]; }
+		const Slot& slot(std::uint32_t index) const { return m_Slabs[index / SlabSize][index % SlabSize]; }
+
+		void pushFree(std::uint32_t first, std::uint32_t last)
+		{
+			std::uint64_t head = m_FreeHead.load(std::memory_order_relaxed);
+			do {
+				slot(last).m_NextFree.store(Index(head), std::memory_order_relaxed);
+			} while (!m_FreeHead.compare_exchange_weak(head, Pack(Tag(head) + 1, first), std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		std::uint32_t grow()
+		{
+			std::lock_guard lock { m_GrowMutex };
+			// Another thread may have grown the pool while we waited for the lock
+			if (Index(m_FreeHead.load(std::memory_order_acquire)) != c_InvalidIndex)
+				return c_InvalidIndex;
+
+			std::uint32_t slabIndex = m_SlabCount.load(std::memory_order_relaxed);
+			if (slabIndex >= MaxSlabs)
+				throw Utils::Exception("JobSystem", "Pool ran out of slabs");
+
+			m_Slabs[slabIndex] = std::make_unique<Slot[]>(SlabSize);
+			m_SlabCount.store(slabIndex + 1, std::memory_order_release);
+
+			// Hand out the first slot and put the rest of the slab on the free list in one go
+			std::uint32_t first = slabIndex * SlabSize;
+			for (std::uint32_t i = 1; i < SlabSize - 1; ++i)
+				slot(first + i).m_NextFree.store(first + i + 1, std::memory_order_relaxed);
+			if constexpr (SlabSize > 1)
+				pushFree(first + 1, first + SlabSize - 1);
+			return first;
+		}
+
+	private:
+		std::atomic_uint64_t m_FreeHead;
+		std::atomic_uint32_t m_SlabCount;
+		std::mutex           m_GrowMutex;
+
+		std::array<std::unique_ptr<Slot[]>, MaxSlabs> m_Slabs;
+	};
+} // namespace JobSystem
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <spdlog/fmt/fmt.h>
+
+#include <cstdint>
+
+#include <vector>
+
+namespace JobSystem
+{
+	struct QueueDepthSample
+	{
+	public:
+		// Nanoseconds since the job system started
+		std::uint64_t time;
+		std::size_t   depth;
+	};
+
+	// Snapshot of the scheduler counters, all durations in nanoseconds
+	struct JobSystemStats
+	{
+	public:
+		std::size_t   threadCount = 0;
+		std::uint64_t uptime      = 0;
+
+		std::uint64_t jobsCreated   = 0;
+		std::uint64_t jobsCompleted = 0;
+		// Threw, or skipped because a dependency failed or their token was cancelled
+		std::uint64_t jobsFailed = 0;
+
+		std::uint64_t stealAttempts = 0;
+		std::uint64_t steals        = 0;
+		// Time workers slept waiting for work
+		std::uint64_t idleTime = 0;
+
+		// The ready queue lock is only taken by threads outside the job system and in critical path mode
+		std::uint64_t queueLockAcquisitions = 0;
+		std::uint64_t queueLockHeldTime     = 0;
+
+		// From a job becoming ready to it starting to run
+		std::uint64_t readyLatencyTotal = 0;
+		std::uint64_t readyLatencyMax   = 0;
+
+		// Ready jobs not yet started, sampled at most once a millisecond
+		std::size_t                   maxQueueDepth = 0;
+		std::vector<QueueDepthSample> queueDepth;
+	};
+} // namespace JobSystem
+
+template <>
+struct fmt::formatter<JobSystem::JobSystemStats>
+{
+public:
+	constexpr auto parse(format_parse_context& ctx) -> decltype(ctx.begin())
+	{
+		return ctx.begin();
+	}
+
+	template <class FormatContext>
+	auto format(const JobSystem::JobSystemStats& stats, FormatContext& ctx) -> decltype(ctx.out())
+	{
+		double workerTime  = static_cast<double>(stats.uptime) * static_cast<double>(stats.threadCount);
+		double idlePercent = workerTime > 0.0 ? stats.idleTime * 100.0 / workerTime : 0.0;
+		double latencyMean = stats.jobsCompleted > 0 ? static_cast<double>(stats.readyLatencyTotal) / stats.jobsCompleted : 0.0;
+		return fmt::format_to(ctx.out(),
+		                      "{} jobs created, {} completed ({} failed) by {} workers in {:.3f} s\n"
+		                      "Workers idle {:.1f}% ({:.3f} s)\n"
+		                      "{} steals out of {} attempts\n"
+		                      "Ready to start latency mean {:.3f} ms, max {:.3f} ms\n"
+		                      "Queue depth max {}\n"
+		                      "Queue lock taken {} times, held {:.3f} ms",
+		                      stats.jobsCreated,
+		                      stats.jobsCompleted,
+		                      stats.jobsFailed,
+		                      stats.threadCount,
+		                      stats.uptime / 1e9,
+		                      idlePercent,
+		                      stats.idleTime / 1e9,
+		                      stats.steals,
+		                      stats.stealAttempts,
+		                      latencyMean / 1e6,
+		                      stats.readyLatencyMax / 1e6,
+		                      stats.maxQueueDepth,
+		                      stats.queueLockAcquisitions,
+		                      stats.queueLockHeldTime / 1e6);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,258 @@
+#pragma once
+
+#include "JobSystem.h"
+#include "Utils/Exception.h"
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace JobSystem
+{
+	template <class T = void>
+	class Task;
+
+	template <class T>
+	JobRef Spawn(JobSystem& jobSystem, Task<T>& task, const std::vector<JobRef>& dependencies = {}, EJobPriority priority = EJobPriority::Normal, std::string_view name = {});
+
+	namespace Details
+	{
+		struct PromiseBase
+		{
+		public:
+			struct FinalAwaiter
+			{
+			public:
+				bool await_ready() noexcept { return false; }
+
+				template <class Promise>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+				{
+					// The owner may destroy the frame as soon as the completion is signaled, so read everything first
+					auto&                   promise      = handle.promise();
+					std::coroutine_handle<> continuation = promise.m_Continuation;
+					JobRef                  completion   = promise.m_Completion;
+					bool                    failed       = static_cast<bool>(promise.m_Exception);
+					if (completion.valid())
+						completion.m_JobSystem->signalEvent(completion, failed);
+					return continuation ? continuation : std::noop_coroutine();
+				}
+
+				void await_resume() noexcept {}
+			};
+
+		public:
+			std::suspend_always initial_suspend() noexcept { return {}; }
+			FinalAwaiter        final_suspend() noexcept { return {}; }
+			void                unhandled_exception() { m_Exception = std::current_exception(); }
+
+			void rethrow()
+			{
+				if (m_Exception)
+					std::rethrow_exception(m_Exception);
+			}
+
+		public:
+			std::coroutine_handle<> m_Continuation;
+			JobRef                  m_Completion;
+			std::exception_ptr      m_Exception;
+		};
+
+		template <class T>
+		struct Promise : PromiseBase
+		{
+		public:
+			Task<T> get_return_object();
+
+			template <class U>
+			void return_value(U&& value)
+			{
+				m_Value.emplace(std::forward<U>(value));
+			}
+
+			T result()
+			{
+				rethrow();
+				return std::move(*m_Value);
+			}
+
+		public:
+			std::optional<T> m_Value;
+		};
+
+		template <>
+		struct Promise<void> : PromiseBase
+		{
+		public:
+			Task<void> get_return_object();
+
+			void return_void() {}
+
+			void result() { rethrow(); }
+		};
+	} // namespace Details
+
+	// Lazily started coroutine, either co_await it from another task or Spawn it onto a job system
+	// co_await a JobRef or WhenAll inside a task to suspend until jobs finished without blocking a worker, it throws if any of them failed meanwhile
+	// A task that throws fails its spawned completion job
+	template <class T>
+	class Task
+	{
+	public:
+		using promise_type = Details::Promise<T>;
+
+	public:
+		Task() = default;
+		explicit Task(std::coroutine_handle<promise_type> handle) : m_Handle(handle) {}
+		Task(Task&& move) noexcept : m_Handle(std::exchange(move.m_Handle, nullptr)) {}
+		Task(const Task&) = delete;
+		~Task()
+		{
+			if (m_Handle)
+				m_Handle.destroy();
+		}
+
+		Task& operator=(Task&& move) noexcept
+		{
+			if (this != &move)
+			{
+				if (m_Handle)
+					m_Handle.destroy();
+				m_Handle = std::exchange(move.m_Handle, nullptr);
+			}
+			return *this;
+		}
+		Task& operator=(const Task&) = delete;
+
+		bool valid() const { return static_cast<bool>(m_Handle); }
+		bool done() const { return m_Handle && m_Handle.done(); }
+
+		// Only valid once the task completed, rethrows anything the task threw
+		T result() { return m_Handle.promise().result(); }
+
+		auto operator co_await() && noexcept
+		{
+			struct Awaiter
+			{
+			public:
+				bool await_ready() noexcept { return false; }
+
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+				{
+					m_Handle.promise().m_Continuation = awaiting;
+					return m_Handle;
+				}
+
+				T await_resume() { return m_Handle.promise().result(); }
+
+			public:
+				std::coroutine_handle<promise_type> m_Handle;
+			};
+
+			return Awaiter { m_Handle };
+		}
+
+	private:
+		std::coroutine_handle<promise_type> m_Handle;
+
+		template <class U>
+		friend JobRef Spawn(JobSystem& jobSystem, Task<U>& task, const std::vector<JobRef>& dependencies, EJobPriority priority, std::string_view name);
+	};
+
+	namespace Details
+	{
+		template <class T>
+		Task<T> Promise<T>::get_return_object()
+		{
+			return Task<T> { std::coroutine_handle<Promise<T>>::from_promise(*this) };
+		}
+
+		inline Task<void> Promise<void>::get_return_object()
+		{
+			return Task<void> { std::coroutine_handle<Promise<void>>::from_promise(*this) };
+		}
+
+		struct WhenAllAwaiter
+		{
+		public:
+			bool await_ready() const
+			{
+				for (auto& job : m_Jobs)
+					if (!job.done())
+						return false;
+				return true;
+			}
+
+			// Resumes from a continuation depending on everything awaited, so no thread waits in the meantime and failures still resume us
+			void await_suspend(std::coroutine_handle<> handle)
+			{
+				JobSystem* jobSystem = nullptr;
+				for (auto& job : m_Jobs)
+				{
+					if (job.valid())
+					{
+						jobSystem = job.m_JobSystem;
+						break;
+					}
+				}
+				jobSystem->createContinuation(
+				    [this, handle](JobRef currentJob)
+				    {
+					    m_Failed = currentJob.dependencyFailed();
+					    handle.resume();
+				    },
+				    m_Jobs,
+				    EJobPriority::High);
+			}
+
+			void await_resume() const
+			{
+				if (m_Failed)
+					throw Utils::Exception("JobSystem", "A job awaited by a task failed");
+			}
+
+		public:
+			std::vector<JobRef> m_Jobs;
+			bool                m_Failed = false;
+		};
+	} // namespace Details
+
+	inline Details::WhenAllAwaiter WhenAll(std::vector<JobRef> jobs)
+	{
+		return Details::WhenAllAwaiter { std::move(jobs) };
+	}
+
+	inline Details::WhenAllAwaiter operator co_await(JobRef job)
+	{
+		return Details::WhenAllAwaiter { { job } };
+	}
+
+	// Starts the task on a worker once all dependencies finished, the returned job finishes when the task completed
+	// If a dependency failed the task never starts, result() throws and the returned job fails
+	// The task has to outlive the returned job
+	template <class T>
+	JobRef Spawn(JobSystem& jobSystem, Task<T>& task, const std::vector<JobRef>& dependencies, EJobPriority priority, std::string_view name)
+	{
+		auto   handle     = task.m_Handle;
+		JobRef completion = jobSystem.createEvent();
+		handle.promise().m_Completion = completion;
+		jobSystem.createContinuation(
+		    [handle](JobRef currentJob)
+		    {
+			    if (!currentJob.dependencyFailed())
+			    {
+				    handle.resume();
+				    return;
+			    }
+
+			    auto& promise       = handle.promise();
+			    promise.m_Exception = std::make_exception_ptr(Utils::Exception("JobSystem", "A dependency of a spawned task failed"));
+			    currentJob.m_JobSystem->signalEvent(promise.m_Completion, true);
+		    },
+		    dependencies,
+		    priority,
+		    name);
+		return completion;
+	}
+} // namespace JobSystem
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "Topology.h"
+#include "Utils/Core.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+
+#if BUILD_IS_SYSTEM_WINDOWS
+	#include <Windows.h>
+#elif BUILD_IS_SYSTEM_LINUX
+	#include <pthread.h>
+	#include <sched.h>
+
+	#include <filesystem>
+#endif
+
+namespace JobSystem
+{
+	static std::vector<ProcessorCore> InterleaveNodes(std::vector<ProcessorCore> cores)
+	{
+		std::map<std::uint32_t, std::vector<ProcessorCore>> nodes;
+		for (auto& core : cores)
+			nodes[core.node].emplace_back(core);
+
+		std::vector<ProcessorCore> interleaved;
+		interleaved.reserve(cores.size());
+		for (std::size_t i = 0; interleaved.size() < cores.size(); ++i)
+			for (auto& [node, nodeCores] : nodes)
+				if (i < nodeCores.size())
+					interleaved.emplace_back(nodeCores[i]);
+		return interleaved;
+	}
+
+#if BUILD_IS_SYSTEM_WINDOWS
+	std::vector<ProcessorCore> GetAvailableCores()
+	{
+		std::vector<ProcessorCore> cores;
+
+		DWORD_PTR processMask = 0, systemMask = 0;
+		if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask) || processMask == 0)
+			processMask = ~DWORD_PTR { 0 };
+		GROUP_AFFINITY primaryAffinity {};
+		GetThreadGroupAffinity(GetCurrentThread(), &primaryAffinity);
+
+		DWORD length = 0;
+		GetLogicalProcessorInformationEx(RelationNumaNode, nullptr, &length);
+		std::vector<std::uint8_t> buffer(length);
+		auto                      info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data());
+		if (length == 0 || !GetLogicalProcessorInformationEx(RelationNumaNode, info, &length))
+		{
+			for (std::uint32_t i = 0, count = std::max(std::thread::hardware_concurrency(), 1U); i < count; ++i)
+				cores.emplace_back(ProcessorCore { 0, i, 0 });
+			return cores;
+		}
+
+		for (DWORD offset = 0; offset < length;)
+		{
+			auto  entry = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+			auto& mask  = entry->NumaNode.GroupMask;
+			for (std::uint32_t i = 0; i < sizeof(KAFFINITY) * 8; ++i)
+			{
+				if (!(mask.Mask & (KAFFINITY { 1 } << i)))
+					continue;
+				// The process affinity mask only describes the process' primary group
+				if (mask.Group == primaryAffinity.Group && !(processMask & (DWORD_PTR { 1 } << i)))
+					continue;
+				cores.emplace_back(ProcessorCore { mask.Group, i, entry->NumaNode.NodeNumber });
+			}
+			offset += entry->Size;
+		}
+		return InterleaveNodes(std::move(cores));
+	}
+
+	std::size_t GetAvailableConcurrency()
+	{
+		std::size_t count = std::max<std::size_t>(GetAvailableCores().size(), 1);
+
+		JOBOBJECT_CPU_RATE_CONTROL_INFORMATION rateControl {};
+		if (QueryInformationJobObject(nullptr, JobObjectCpuRateControlInformation, &rateControl, sizeof(rateControl), nullptr) &&
+		    (rateControl.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_ENABLE) &&
+		    (rateControl.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP))
+		{
+			// CpuRate is the share of the whole machine in 1/100th of a percent
+			std::size_t total = std::max<std::size_t>(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), 1);
+			std::size_t quota = static_cast<std::size_t>(std::ceil(rateControl.CpuRate * total / 10000.0));
+			count             = std::clamp<std::size_t>(quota, 1, count);
+		}
+		return count;
+	}
+
+	bool PinCurrentThread(const ProcessorCore& core)
+	{
+		GROUP_AFFINITY affinity {};
+		affinity.Group = core.group;
+		affinity.Mask  = KAFFINITY { 1 } << core.index;
+		return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr);
+	}
+#elif BUILD_IS_SYSTEM_LINUX
+	static std::vector<std::uint32_t> ParseCPUList(const std::string& list)
+	{
+		std::vector<std::uint32_t> cpus;
+		std::size_t                offset = 0;
+		while (offset < list.size())
+		{
+			std::size_t end = list.find(',', offset);
+			if (end == std::string::npos)
+				end = list.size();
+			std::string range = list.substr(offset, end - offset);
+			offset            = end + 1;
+
+			std::uint32_t first = 0, last = 0;
+			int           count = std::sscanf(range.c_str(), "%u-%u", &first, &last);
+			if (count < 1)
+				continue;
+			if (count < 2)
+				last = first;
+			for (std::uint32_t cpu = first; cpu <= last; ++cpu)
+				cpus.emplace_back(cpu);
+		}
+		return cpus;
+	}
+
+	std::vector<ProcessorCore> GetAvailableCores()
+	{
+		std::vector<ProcessorCore> cores;
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		if (sched_getaffinity(0, sizeof(set), &set) != 0)
+		{
+			for (std::uint32_t i = 0, count = std::max(std::thread::hardware_concurrency(), 1U); i < count; ++i)
+				cores.emplace_back(ProcessorCore { 0, i, 0 });
+			return cores;
+		}
+
+		std::map<std::uint32_t, std::uint32_t> cpuNodes;
+		std::error_code                        error;
+		for (auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error))
+		{
+			std::uint32_t node     = 0;
+			auto          filename = entry.path().filename().string();
+			if (std::sscanf(filename.c_str(), "node%u", &node) < 1)
+				continue;
+
+			std::ifstream cpuList { entry.path() / "cpulist" };
+			std::string   list;
+			std::getline(cpuList, list);
+			for (auto cpu : ParseCPUList(list))
+				cpuNodes[cpu] = node;
+		}
+
+		for (std::uint32_t i = 0; i < CPU_SETSIZE; ++i)
+		{
+			if (!CPU_ISSET(i, &set))
+				continue;
+			auto itr = cpuNodes.find(i);
+			cores.emplace_back(ProcessorCore { 0, i, itr != cpuNodes.end() ? itr->second : 0 });
+		}
+		return InterleaveNodes(std::move(cores));
+	}
+
+	static double GetCGroupQuota()
+	{
+		// cgroup v2
+		{
+			std::ifstream cpuMax { "/sys/fs/cgroup/cpu.max" };
+			std::string   quota;
+			double        period = 0.0;
+			if (cpuMax >> quota >> period)
+				return quota != "max" && period > 0.0 ? std::stod(quota) / period : 0.0;
+		}
+		// cgroup v1
+		{
+			std::ifstream quotaFile { "/sys/fs/cgroup/cpu/cpu.cfs_quota_us" };
+			std::ifstream periodFile { "/sys/fs/cgroup/cpu/cpu.cfs_period_us" };
+			double        quota = 0.0, period = 0.0;
+			if ((quotaFile >> quota) && (periodFile >> period) && quota > 0.0 && period > 0.0)
+				return quota / period;
+		}
+		return 0.0;
+	}
+
+	std::size_t GetAvailableConcurrency()
+	{
+		std::size_t count = std::max<std::size_t>(GetAvailableCores().size(), 1);
+		double      quota = GetCGroupQuota();
+		if (quota > 0.0)
+			count = std::clamp<std::size_t>(static_cast<std::size_t>(std::ceil(quota)), 1, count);
+		return count;
+	}
+
+	bool PinCurrentThread(const ProcessorCore& core)
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(core.index, &set);
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+	}
+#else
+	std::vector<ProcessorCore> GetAvailableCores()
+	{
+		std::vector<ProcessorCore> cores;
+		for (std::uint32_t i = 0, count = std::max(std::thread::hardware_concurrency(), 1U); i < count; ++i)
+			cores.emplace_back(ProcessorCore { 0, i, 0 });
+		return cores;
+	}
+
+	std::size_t GetAvailableConcurrency()
+	{
+		return std::max(std::thread::hardware_concurrency(), 1U);
+	}
+
+	bool PinCurrentThread([[maybe_unused]] const ProcessorCore& core)
+	{
+		return false;
+	}
+#endif
+} // namespace JobSystem
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vector>
+
+namespace JobSystem
+{
+	struct ProcessorCore
+	{
+	public:
+		std::uint16_t group;
+		std::uint32_t index;
+		std::uint32_t node;
+	};
+
+	// Logical processors this process may run on, interleaved across NUMA nodes so consecutive workers spread over all sockets
+	std::vector<ProcessorCore> GetAvailableCores();
+	// Number of processors worth of CPU time this process may use, respects affinity masks and CPU quotas (cgroups, job objects)
+	std::size_t GetAvailableConcurrency();
+	bool        PinCurrentThread(const ProcessorCore& core);
+} // namespace JobSystem
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "Trace.h"
+
+#include <spdlog/fmt/fmt.h>
+
+#include <fstream>
+#include <unordered_map>
+
+namespace JobSystem
+{
+	std::atomic_uint64_t JobTracer::s_NextInstanceId = 1;
+
+	thread_local JobTracer::Buffer* JobTracer::tl_Buffer      = nullptr;
+	thread_local std::uint64_t      JobTracer::tl_BufferOwner = 0;
+
+	static std::string JSONEscape(std::string_view str)
+	{
+		std::string escaped;
+		escaped.reserve(str.size());
+		for (char c : str)
+		{
+			switch (c)
+			{
+			case '"':
+				escaped += "\\\"";
+				break;
+			case '\\':
+				escaped += "\\\\";
+				break;
+			case '\n':
+				escaped += "\\n";
+				break;
+			case '\t':
+				escaped += "\\t";
+				break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+					escaped += fmt::format("\\u{:04x}", static_cast<unsigned char>(c));
+				else
+					escaped += c;
+				break;
+			}
+		}
+		return escaped;
+	}
+
+	static double ToMicroseconds(std::int64_t nanoseconds)
+	{
+		return nanoseconds / 1000.0;
+	}
+
+	JobTracer::JobTracer()
+	    : m_InstanceId(s_NextInstanceId.fetch_add(1)) {}
+
+	void JobTracer::start()
+	{
+		if (enabled())
+			return;
+
+		m_Start = Clock::now();
+		m_Enabled.store(true, std::memory_order_release);
+	}
+
+	JobTracer::Buffer& JobTracer::threadBuffer()
+	{
+		if (tl_BufferOwner == m_InstanceId)
+			return *tl_Buffer;
+
+		std::lock_guard lock { m_BuffersMutex };
+		auto&           buffer = m_Buffers.emplace_back(std::make_unique<Buffer>());
+		buffer->m_ThreadId     = static_cast<std::uint32_t>(m_Buffers.size());
+		tl_Buffer              = buffer.get();
+		tl_BufferOwner         = m_InstanceId;
+		return *buffer;
+	}
+
+	bool JobTracer::write(const std::filesystem::path& path) const
+	{
+		std::ofstream file { path };
+		if (!file)
+			return false;
+
+		std::lock_guard lock { m_BuffersMutex };
+
+		// Dependency arrows go from the end of the dependency to the start of the dependent
+		std::unordered_map<std::uint64_t, std::pair<const Buffer*, const Event*>> jobs;
+		for (auto& buffer : m_Buffers)
+			for (auto& event : buffer->m_Events)
+				if (event.m_Type == ETraceEventType::Job)
+					jobs[event.m_Id] = { buffer.get(), &event };
+
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		auto emit  = [&](const std::string& str)
+		{
+			if (!first)
+				file << ",\n";
+			file << str;
+			first = false;
+		};
+
+		for (auto& buffer : m_Buffers)
+		{
+			std::string threadName = buffer->m_ThreadName.empty() ? fmt::format("Thread {}", buffer->m_ThreadId) : buffer->m_ThreadName;
+			emit(fmt::format(R"({{"ph":"M","pid":1,"tid":{},"name":"thread_name","args":{{"name":"{}"}}}})", buffer->m_ThreadId, JSONEscape(threadName)));
+
+			for (auto& event : buffer->m_Events)
+			{
+				switch (event.m_Type)
+				{
+				case ETraceEventType::Job:
+					emit(fmt::format(R"({{"ph":"X","pid":1,"tid":{},"cat":"job","name":"{}","ts":{:.3f},"dur":{:.3f},"args":{{"id":{},"dependency_wait_us":{:.3f},"queued_us":{:.3f}}}}})",
+					                 buffer->m_ThreadId,
+					                 event.m_Name.empty() ? "Job" : JSONEscape(event.m_Name),
+					                 ToMicroseconds(event.m_Begin),
+					                 ToMicroseconds(event.m_End - event.m_Begin),
+					                 event.m_Id,
+					                 ToMicroseconds(event.m_Ready - event.m_Created),
+					                 ToMicroseconds(event.m_Begin - event.m_Ready)));
+					break;
+				case ETraceEventType::Wait:
+					emit(fmt::format(R"({{"ph":"X","pid":1,"tid":{},"cat":"wait","name":"Wait","ts":{:.3f},"dur":{:.3f},"args":{{"job":{}}}}})",
+					                 buffer->m_ThreadId,
+					                 ToMicroseconds(event.m_Begin),
+					                 ToMicroseconds(event.m_End - event.m_Begin),
+					                 event.m_Id));
+					break;
+				case ETraceEventType::Idle:
+					emit(fmt::format(R"({{"ph":"X","pid":1,"tid":{},"cat":"idle","name":"Idle","ts":{:.3f},"dur":{:.3f}}})",
+					                 buffer->m_ThreadId,
+					                 ToMicroseconds(event.m_Begin),
+					                 ToMicroseconds(event.m_End - event.m_Begin)));
+					break;
+				}
+			}
+		}
+
+		std::uint64_t flowId = 0;
+		for (auto& buffer : m_Buffers)
+		{
+			for (auto& edge : buffer->m_Edges)
+			{
+				auto from = jobs.find(edge.m_From);
+				auto to   = jobs.find(edge.m_To);
+				if (from == jobs.end() || to == jobs.end())
+					continue;
+
+				++flowId;
+				emit(fmt::format(R"({{"ph":"s","pid":1,"tid":{},"cat":"dependency","name":"dependency","id":{},"ts":{:.3f}}})", from->second.first->m_ThreadId, flowId, ToMicroseconds(from->second.second->m_End)));
+				emit(fmt::format(R"({{"ph":"f","bp":"e","pid":1,"tid":{},"cat":"dependency","name":"dependency","id":{},"ts":{:.3f}}})", to->second.first->m_ThreadId, flowId, ToMicroseconds(to->second.second->m_Begin)));
+			}
+		}
+		file << "\n]}\n";
+		return static_cast<bool>(file);
+	}
+} // namespace JobSystem
\ No newline at end of file
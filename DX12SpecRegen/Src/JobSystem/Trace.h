@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace JobSystem
+{
+	enum class ETraceEventType : std::uint8_t
+	{
+		Job,
+		Wait,
+		Idle
+	};
+
+	// Records what every thread did, each thread appends to its own buffer so recording never takes a lock
+	class JobTracer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		struct Event
+		{
+		public:
+			ETraceEventType m_Type;
+			std::uint64_t   m_Id;
+			// Nanoseconds since tracing started
+			std::int64_t m_Begin;
+			std::int64_t m_End;
+			std::int64_t m_Created;
+			std::int64_t m_Ready;
+			std::string  m_Name;
+		};
+
+		struct Edge
+		{
+		public:
+			std::uint64_t m_From;
+			std::uint64_t m_To;
+		};
+
+		struct Buffer
+		{
+		public:
+			std::uint32_t      m_ThreadId;
+			std::string        m_ThreadName;
+			std::vector<Event> m_Events;
+			std::vector<Edge>  m_Edges;
+		};
+
+	public:
+		JobTracer();
+
+		void start();
+		bool enabled() const { return m_Enabled.load(std::memory_order_acquire); }
+
+		std::int64_t  since(Clock::time_point time) const { return std::chrono::duration_cast<std::chrono::nanoseconds>(time - m_Start).count(); }
+		std::int64_t  now() const { return since(Clock::now()); }
+		std::uint64_t nextId() { return m_NextId.fetch_add(1, std::memory_order_relaxed); }
+
+		// The calling thread's buffer, created on first use
+		Buffer& threadBuffer();
+
+		// Chrome trace event JSON, loads in chrome://tracing and Perfetto, only call once no thread records anymore
+		bool write(const std::filesystem::path& path) const;
+
+	private:
+		std::uint64_t                        m_InstanceId;
+		std::atomic_bool                     m_Enabled = false;
+		Clock::time_point                    m_Start;
+		std::atomic_uint64_t                 m_NextId = 1;
+		mutable std::mutex                   m_BuffersMutex;
+		std::vector<std::unique_ptr<Buffer>> m_Buffers;
+
+		static std::atomic_uint64_t s_NextInstanceId;
+
+		// Keyed by instance id rather than address, a new tracer may reuse a destroyed one's address
+		static thread_local Buffer*       tl_Buffer;
+		static thread_local std::uint64_t tl_BufferOwner;
+	};
+} // namespace JobSystem
\ No newline at end of file
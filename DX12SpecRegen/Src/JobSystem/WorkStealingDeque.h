@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace JobSystem
+{
+	// Chase-Lev work stealing deque, memory orderings follow "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê et al. 2013)
+	// push and pop may only be called by the owning thread, steal may be called by any thread
+	template <class T>
+	class WorkStealingDeque
+	{
+	public:
+		static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque only supports trivially copyable types");
+
+	public:
+		WorkStealingDeque(std::size_t capacity = 256)
+		    : m_Top(0), m_Bottom(0)
+		{
+			m_Buffer.store(m_Buffers.emplace_back(std::make_unique<Buffer>(std::bit_ceil(capacity))).get(), std::memory_order_relaxed);
+		}
+
+		WorkStealingDeque(const WorkStealingDeque&) = delete;
+		WorkStealingDeque(WorkStealingDeque&&)      = delete;
+		WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+		WorkStealingDeque& operator=(WorkStealingDeque&&) = delete;
+
+		void push(T value)
+		{
+			std::int64_t b      = m_Bottom.load(std::memory_order_relaxed);
+			std::int64_t t      = m_Top.load(std::memory_order_acquire);
+			Buffer*      buffer = m_Buffer.load(std::memory_order_relaxed);
+			if (b - t > buffer->capacity() - 1)
+				buffer = grow(buffer, b, t);
+			buffer->put(b, value);
+			m_Bottom.store(b + 1, std::memory_order_release);
+		}
+
+		bool pop(T& value)
+		{
+			std::int64_t b      = m_Bottom.load(std::memory_order_relaxed) - 1;
+			Buffer*      buffer = m_Buffer.load(std::memory_order_relaxed);
+			m_Bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			std::int64_t t = m_Top.load(std::memory_order_relaxed);
+			if (t > b)
+			{
+				m_Bottom.store(b + 1, std::memory_order_relaxed);
+				return false;
+			}
+
+			value = buffer->get(b);
+			if (t != b)
+				return true;
+
+			// Last element, race against stealers for it
+			bool won = m_Top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+			m_Bottom.store(b + 1, std::memory_order_relaxed);
+			return won;
+		}
+
+		bool steal(T& value)
+		{
+			std::int64_t t = m_Top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			std::int64_t b = m_Bottom.load(std::memory_order_acquire);
+			if (t >= b)
+				return false;
+
+			Buffer* buffer = m_Buffer.load(std::memory_order_acquire);
+			value          = buffer->get(t);
+			return m_Top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		}
+
+		std::size_t size() const
+		{
+			std::int64_t b = m_Bottom.load(std::memory_order_relaxed);
+			std::int64_t t = m_Top.load(std::memory_order_relaxed);
+			return b > t ? static_cast<std::size_t>(b - t) : 0;
+		}
+
+		bool empty() const { return size() == 0; }
+
+	private:
+		struct Buffer
+		{
+		public:
+			Buffer(std::size_t capacity)
+			    : m_Mask(static_cast<std::int64_t>(capacity) - 1), m_Data(std::make_unique<std::atomic<T>[]>(capacity)) {}
+
+			std::int64_t capacity() const { return m_Mask + 1; }
+
+			T    get(std::int64_t index) const { return m_Data[index & m_Mask].load(std::memory_order_relaxed); }
+			void put(std::int64_t index, T value) { m_Data[index & m_Mask].store(value, std::memory_order_relaxed); }
+
+		private:
+			std::int64_t                      m_Mask;
+			std::unique_ptr<std::atomic<T>[]> m_Data;
+		};
+
+		Buffer* grow(Buffer* buffer, std::int64_t bottom, std::int64_t top)
+		{
+			// Stealers may still be reading the old buffer, so it is retired instead of freed
+			auto newBuffer = m_Buffers.emplace_back(std::make_unique<Buffer>(static_cast<std::size_t>(buffer->capacity()) * 2)).get();
+			for (std::int64_t i = top; i < bottom; ++i)
+				newBuffer->put(i, buffer->get(i));
+			m_Buffer.store(newBuffer, std::memory_order_release);
+			return newBuffer;
+		}
+
+	private:
+		alignas(64) std::atomic_int64_t m_Top;
+		alignas(64) std::atomic_int64_t m_Bottom;
+		alignas(64) std::atomic<Buffer*> m_Buffer;
+
+		std::vector<std::unique_ptr<Buffer>> m_Buffers;
+	};
+} // namespace JobSystem
\ No newline at end of file
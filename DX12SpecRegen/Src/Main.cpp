@@ -1,33 +1,160 @@
 #include "HeaderIntrospectionStage.h"
+#include "IntrospectionCache.h"
+#include "IntrospectionProcess.h"
+#include "JobSystem/JobGraph.h"
 #include "JobSystem/JobSystem.h"
+#include "JobSystem/Task.h"
 #include "SDKInfo.h"
 #include "SDKVersion.h"
 #include "Serialization/XMLSerialization.h"
 #include "Utils/Exception.h"
 #include "Utils/Log.h"
 
+#include <chrono>
+#include <deque>
 #include <fstream>
+#include <limits>
+#include <optional>
 #include <thread>
 
 // TODO(MarcasRealAccount): Handle anonymous unions in structs
 
+// Shared by every job of an sdk
+struct SDKContext
+{
+public:
+	std::vector<std::string>                  args;
+	ClangIntrospection::SDKFileSystem         fileSystem;
+	ClangIntrospection::EIntrospectionProfile profile = ClangIntrospection::EIntrospectionProfile::Fast;
+};
+
+static void InitSDKContext(SDKContext& context, const SDKVersion& sdkVersion)
+{
+	auto& args = context.args;
+	args.emplace_back("-isystem");
+	args.emplace_back(sdkVersion.path.string());
+	args.emplace_back("-isystem");
+	args.emplace_back((sdkVersion.path / "shared").string());
+	args.emplace_back("-isystem");
+	args.emplace_back((sdkVersion.path / "ucrt").string());
+	args.emplace_back("-isystem");
+	args.emplace_back((sdkVersion.path / "um").string());
+	args.emplace_back("-I");
+	args.emplace_back(sdkVersion.path.string());
+	args.emplace_back("-I");
+	args.emplace_back((sdkVersion.path / "shared").string());
+	args.emplace_back("-I");
+	args.emplace_back((sdkVersion.path / "ucrt").string());
+	args.emplace_back("-I");
+	args.emplace_back((sdkVersion.path / "um").string());
+	args.emplace_back("-x");
+	args.emplace_back("c++");
+	args.emplace_back("-std=c++20");
+	for (auto& directory : { sdkVersion.path, sdkVersion.path / "shared", sdkVersion.path / "ucrt", sdkVersion.path / "um" })
+		context.fileSystem.addSearchDirectory(directory);
+}
+
 struct CompileHeaderJob
 {
 public:
-	CompileHeaderJob(const std::vector<std::string>& args, std::filesystem::path path, SDKInfo::Header* headerInfo)
-	    : m_Args(args), m_Path(path), m_HeaderInfo(headerInfo) {}
+	// context and path are shared by every job of an sdk and have to outlive the job, without processes the header is introspected in this process
+	// The result is stored under cacheKey when there is a cache, cacheKey has to outlive the job as well
+	CompileHeaderJob(SDKContext& context, const std::filesystem::path& path, SDKInfo::Header* headerInfo, JobSystem::CancellationToken token, ClangIntrospection::IntrospectionProcessPool* processes, ClangIntrospection::IntrospectionCache* cache, const std::string& cacheKey)
+	    : m_Context(&context), m_Path(&path), m_HeaderInfo(headerInfo), m_Token(std::move(token)), m_Processes(processes), m_Cache(cache), m_CacheKey(&cacheKey) {}
 
 	void operator()(JobSystem::JobRef currentJob)
 	{
-		Log::Info("Regenerating header '{}'", m_Path.string());
-		ClangIntrospection::Introspect(m_Args, m_Path, m_HeaderInfo);
-		Log::Info("Regenerated header '{}'", m_Path.string());
+		Log::Info("Regenerating header '{}'", m_Path->string());
+		std::vector<std::filesystem::path> dependencies;
+		bool                               result = false;
+		if (m_Processes)
+		{
+			auto processResult = m_Processes->introspect(m_Context->args, *m_Path, m_HeaderInfo, &dependencies, m_Context->profile);
+			// Only this header is missing from the spec, unlike a failure a crash doesn't cancel the other jobs
+			if (processResult == ClangIntrospection::EProcessResult::Crash)
+			{
+				Log::Error("Leaving out header '{}', it crashed every process introspecting it", m_Path->string());
+				return;
+			}
+			result = processResult == ClangIntrospection::EProcessResult::Success;
+		}
+		else
+		{
+			result = ClangIntrospection::Introspect(m_Context->args, *m_Path, m_HeaderInfo, *currentJob.m_JobSystem, m_Token, &dependencies, &m_Context->fileSystem, m_Context->profile);
+		}
+		// A cancelled run fails because of another job, and what it left out mustn't end up in the cache
+		if (!result && m_Token.cancelled())
+			return;
+		if (!result)
+			throw Utils::Exception("ClangIntrospection", fmt::format("Failed to regenerate header '{}'", m_Path->string()));
+		if (m_Cache && !m_Cache->store(*m_CacheKey, { m_HeaderInfo, 1 }, dependencies))
+			Log::Warn("Failed to cache header '{}'", m_Path->string());
+		Log::Info("Regenerated header '{}'", m_Path->string());
 	}
 
 private:
-	std::vector<std::string> m_Args;
-	std::filesystem::path    m_Path;
-	SDKInfo::Header*         m_HeaderInfo;
+	SDKContext*                                   m_Context;
+	const std::filesystem::path*                  m_Path;
+	SDKInfo::Header*                              m_HeaderInfo;
+	JobSystem::CancellationToken                  m_Token;
+	ClangIntrospection::IntrospectionProcessPool* m_Processes;
+	ClangIntrospection::IntrospectionCache*       m_Cache;
+	const std::string*                            m_CacheKey;
+};
+
+struct CompileSDKJob
+{
+public:
+	// Introspects every header of an sdk in a single translation unit, headerInfos must not be resized while the job runs
+	CompileSDKJob(SDKContext& context, const SDKVersion& sdkVersion, std::vector<SDKInfo::Header>& headerInfos, JobSystem::CancellationToken token, ClangIntrospection::IntrospectionCache* cache, const std::string& cacheKey)
+	    : m_Context(&context), m_SDKVersion(&sdkVersion), m_HeaderInfos(&headerInfos), m_Token(std::move(token)), m_Cache(cache), m_CacheKey(&cacheKey) {}
+
+	void operator()(JobSystem::JobRef currentJob)
+	{
+		Log::Info("Regenerating sdk '{}'", m_SDKVersion->name);
+		std::vector<std::filesystem::path> dependencies;
+		bool                               result = ClangIntrospection::IntrospectSDK(m_Context->args, m_SDKVersion->headers, *m_HeaderInfos, *currentJob.m_JobSystem, m_Token, &dependencies, &m_Context->fileSystem, m_Context->profile);
+		if (!result && m_Token.cancelled())
+			return;
+		if (!result)
+			throw Utils::Exception("ClangIntrospection", fmt::format("Failed to regenerate sdk '{}'", m_SDKVersion->name));
+		if (m_Cache && !m_Cache->store(*m_CacheKey, *m_HeaderInfos, dependencies))
+			Log::Warn("Failed to cache sdk '{}'", m_SDKVersion->name);
+		Log::Info("Regenerated sdk '{}'", m_SDKVersion->name);
+	}
+
+private:
+	SDKContext*                             m_Context;
+	const SDKVersion*                       m_SDKVersion;
+	std::vector<SDKInfo::Header>*           m_HeaderInfos;
+	JobSystem::CancellationToken            m_Token;
+	ClangIntrospection::IntrospectionCache* m_Cache;
+	const std::string*                      m_CacheKey;
+};
+
+struct PrecompilePreludeJob
+{
+public:
+	// Every header job of the sdk depends on this one, so extending args here is safe
+	PrecompilePreludeJob(SDKContext& context, std::filesystem::path pchPath)
+	    : m_Context(&context), m_PCHPath(std::move(pchPath)) {}
+
+	void operator()(JobSystem::JobRef currentJob)
+	{
+		Log::Info("Precompiling prelude '{}'", m_PCHPath.string());
+		if (!ClangIntrospection::PrecompilePrelude(m_Context->args, m_PCHPath, &m_Context->fileSystem, m_Context->profile))
+		{
+			Log::Warn("Failed to precompile prelude '{}', headers will parse it themselves", m_PCHPath.string());
+			return;
+		}
+		m_Context->args.emplace_back("-include-pch");
+		m_Context->args.emplace_back(m_PCHPath.string());
+		Log::Info("Precompiled prelude '{}'", m_PCHPath.string());
+	}
+
+private:
+	SDKContext*           m_Context;
+	std::filesystem::path m_PCHPath;
 };
 
 struct RemoverJob
@@ -39,7 +166,7 @@ public:
 	void operator()(JobSystem::JobRef currentJob)
 	{
 		Log::Info("Removing old stuff from '{}'", m_Newer->version);
-		SDKInfo::RemovePreviousSDK(*m_Newer, *m_Older);
+		SDKInfo::RemovePreviousSDK(*m_Newer, *m_Older, *currentJob.m_JobSystem);
 		Log::Info("Removed old stuff from '{}'", m_Newer->version);
 	}
 
@@ -65,102 +192,285 @@ private:
 	std::vector<SDKInfo::SDK>* m_SDK;
 };
 
-int safeMain([[maybe_unused]] int argc, [[maybe_unused]] const char** argv)
+struct Options
 {
-	std::size_t threadCount = 16;
+public:
+	std::size_t           threadCount  = 0;
+	bool                  pinThreads   = false;
+	bool                  criticalPath = false;
+	std::size_t           processes    = 0;
+	bool                  noPCH        = false;
+	bool                  singleTU     = false;
+	bool                  fullParse    = false;
+	bool                  benchmark    = false;
+	std::filesystem::path tracePath;
+	std::filesystem::path cachePath = "cache";
+
+	// Set in the child processes started for --processes
+	std::string workerInput;
+	std::string workerOutput;
+};
 
-	std::vector<SDKVersion>   sdkVersions;
-	std::vector<SDKInfo::SDK> sdkInfos;
-	JobSystem::JobSystem      jobSystem { threadCount };
-	JobSystem::JobRef         preProcessJob;
+static Options ParseOptions(int argc, const char** argv)
+{
+	Options options {};
+	for (int i = 1; i < argc; ++i)
 	{
-		auto firstJob = jobSystem.createJob(
-		    [&](JobSystem::JobRef currentJob)
-		    {
-			    std::vector<JobSystem::JobRef> allJobs;
-			    sdkVersions = LocateAvailableSDKVersions("./");
-			    Log::Info("Found {} sdks", sdkVersions.size());
-			    for (auto& sdk : sdkVersions)
-				    Log::Info("{} at '{}' with {} dxgis", sdk.name, sdk.path.string(), sdk.dxgis.size());
-
-			    sdkInfos.resize(sdkVersions.size(), {});
-			    std::vector<JobSystem::JobRef> refs;
-			    for (std::size_t i = sdkVersions.size(); i > 0; --i)
-			    {
-				    auto& sdkVersion = sdkVersions[i - 1];
-				    auto& sdkInfo    = sdkInfos[i - 1];
-				    sdkInfo.version  = sdkVersion.name;
-
-				    std::vector<std::string> args;
-				    args.emplace_back("-isystem");
-				    args.emplace_back(sdkVersion.path.string());
-				    args.emplace_back("-isystem");
-				    args.emplace_back((sdkVersion.path / "shared").string());
-				    args.emplace_back("-isystem");
-				    args.emplace_back((sdkVersion.path / "ucrt").string());
-				    args.emplace_back("-isystem");
-				    args.emplace_back((sdkVersion.path / "um").string());
-				    args.emplace_back("-I");
-				    args.emplace_back(sdkVersion.path.string());
-				    args.emplace_back("-I");
-				    args.emplace_back((sdkVersion.path / "shared").string());
-				    args.emplace_back("-I");
-				    args.emplace_back((sdkVersion.path / "ucrt").string());
-				    args.emplace_back("-I");
-				    args.emplace_back((sdkVersion.path / "um").string());
-				    args.emplace_back("-x");
-				    args.emplace_back("c++");
-				    args.emplace_back("-std=c++20");
-
-				    sdkInfo.headers.reserve(sdkVersion.headers.size());
-				    for (auto& header : sdkVersion.headers)
-				    {
-					    auto& sdkHeader = sdkInfo.headers.emplace_back();
-					    sdkHeader.name  = std::filesystem::relative(header, sdkVersion.path).string();
-					    allJobs.emplace_back(refs.emplace_back(currentJob.m_JobSystem->createJob(CompileHeaderJob { args, header, &sdkHeader }, { currentJob })));
-				    }
-
-				    if (i < sdkVersions.size())
-				    {
-					    auto removerJob = currentJob.m_JobSystem->createJob(RemoverJob { &sdkInfos[i], &sdkInfo }, refs);
-					    refs.erase(refs.begin(), refs.begin() + sdkInfo.headers.size());
-					    allJobs.emplace_back(removerJob);
-				    }
-			    }
-
-			    preProcessJob = currentJob.m_JobSystem->createJob(PostProcessJob { &sdkInfos }, allJobs);
-
-			    Log::Info("Readied all compile jobs");
-		    },
-		    {});
-
-		jobSystem.waitForJob(firstJob);
+		std::string_view arg = argv[i];
+		if ((arg == "-j" || arg == "--threads") && i + 1 < argc)
+			options.threadCount = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--pin-threads")
+			options.pinThreads = true;
+		else if (arg == "--critical-path")
+			options.criticalPath = true;
+		else if (arg == "--trace" && i + 1 < argc)
+			options.tracePath = argv[++i];
+		else if (arg == "--no-pch")
+			options.noPCH = true;
+		else if (arg == "--single-tu")
+			options.singleTU = true;
+		else if (arg == "--full-parse")
+			options.fullParse = true;
+		else if (arg == "--benchmark-parse")
+			options.benchmark = true;
+		else if (arg == "--cache" && i + 1 < argc)
+			options.cachePath = argv[++i];
+		else if (arg == "--no-cache")
+			options.cachePath.clear();
+		else if (arg == "--processes" && i + 1 < argc)
+			options.processes = std::strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--introspect-worker" && i + 2 < argc)
+		{
+			options.workerInput  = argv[++i];
+			options.workerOutput = argv[++i];
+		}
+		else
+			Log::Warn("Unknown argument '{}'", arg);
 	}
+	return options;
+}
+
+static JobSystem::Task<> RegenerateSpec(JobSystem::JobSystem& jobSystem, const Options& options)
+{
+	std::vector<SDKVersion>                sdkVersions;
+	std::vector<SDKContext>                sdkContexts;
+	std::vector<SDKInfo::SDK>              sdkInfos;
+	std::vector<JobSystem::JobGraph::Node> allJobs;
+	std::deque<std::string>                cacheKeys;
+
+	sdkVersions = LocateAvailableSDKVersions("./");
+	Log::Info("Found {} sdks", sdkVersions.size());
+	for (auto& sdk : sdkVersions)
+		Log::Info("{} at '{}' with {} dxgis", sdk.name, sdk.path.string(), sdk.dxgis.size());
 
+	// Nothing starts before the whole graph was submitted, so critical path ranks are complete
+	JobSystem::JobGraph graph;
+	// Any header failing spoils the output, so the first failure skips everything not started yet
+	auto token = JobSystem::CancellationToken::Create();
+
+	// The children split the workers between them
+	std::unique_ptr<ClangIntrospection::IntrospectionProcessPool> processes;
+	if (options.singleTU && options.processes > 0)
+		Log::Warn("--processes is ignored with --single-tu, every sdk is introspected in this process");
+	else if (options.processes > 0)
+		processes = std::make_unique<ClangIntrospection::IntrospectionProcessPool>(options.processes, std::max<std::size_t>(jobSystem.threadCount() / options.processes, 1));
+
+	// A header job blocks its worker until its child answered, so header jobs are chained into one lane per child
+	// Only one job per lane is ever in flight, the pool never makes a worker wait for a free child and the other workers keep running ready jobs
+	std::vector<std::optional<JobSystem::JobGraph::Node>> processLanes;
+	std::size_t                                           nextProcessLane = 0;
+	if (processes)
+		processLanes.resize(processes->processCount());
+
+	// Released SDKs never change, so most runs only introspect SDKs that weren't there before
+	std::unique_ptr<ClangIntrospection::IntrospectionCache> cache;
+	if (!options.cachePath.empty())
+		cache = std::make_unique<ClangIntrospection::IntrospectionCache>(options.cachePath);
+
+	sdkContexts.resize(sdkVersions.size());
+	sdkInfos.resize(sdkVersions.size(), {});
+	std::vector<JobSystem::JobGraph::Node> refs;
+	for (std::size_t i = sdkVersions.size(); i > 0; --i)
+	{
+		auto& sdkVersion = sdkVersions[i - 1];
+		auto& sdkInfo    = sdkInfos[i - 1];
+		auto& context    = sdkContexts[i - 1];
+		auto& args       = context.args;
+		sdkInfo.version  = sdkVersion.name;
+
+		InitSDKContext(context, sdkVersion);
+		// Both profiles produce the same headers, so cache entries are shared between them
+		if (options.fullParse)
+			context.profile = ClangIntrospection::EIntrospectionProfile::Full;
+
+		// Only precompile the prelude when something of the sdk missed the cache
+		std::optional<JobSystem::JobGraph::Node> precompileJob;
+		auto                                     addCompileJob = [&](JobSystem::JobGraph::Node job)
+		{
+			allJobs.emplace_back(refs.emplace_back(job));
+			if (!precompileJob && !options.noPCH)
+				precompileJob = graph.add(PrecompilePreludeJob { context, std::filesystem::temp_directory_path() / "DX12SpecRegen" / (sdkVersion.name + ".pch") }, JobSystem::EJobPriority::High, "Precompile " + sdkVersion.name, token);
+			if (precompileJob)
+				graph.addEdge(*precompileJob, job);
+		};
+
+		std::size_t newerRefs = refs.size();
+		sdkInfo.headers.reserve(sdkVersion.headers.size());
+		for (auto& header : sdkVersion.headers)
+		{
+			auto& sdkHeader = sdkInfo.headers.emplace_back();
+			sdkHeader.name  = std::filesystem::relative(header, sdkVersion.path).string();
+			if (options.singleTU)
+				continue;
+
+			auto& cacheKey = cacheKeys.emplace_back();
+			if (cache)
+			{
+				cacheKey = cache->key(args, { &header, 1 });
+				if (cache->load(cacheKey, { &sdkHeader, 1 }))
+				{
+					Log::Info("Loaded header '{}' from the cache", header.string());
+					continue;
+				}
+			}
+			auto compileJob = graph.add(CompileHeaderJob { context, header, &sdkHeader, token, processes.get(), cache.get(), cacheKey }, JobSystem::EJobPriority::Normal, sdkInfo.version + "/" + sdkHeader.name, token);
+			addCompileJob(compileJob);
+			if (processes)
+			{
+				auto& lane = processLanes[nextProcessLane++ % processLanes.size()];
+				if (lane)
+					graph.addEdge(*lane, compileJob);
+				lane = compileJob;
+			}
+		}
+		if (options.singleTU)
+		{
+			auto& cacheKey = cacheKeys.emplace_back();
+			if (cache)
+				cacheKey = cache->key(args, sdkVersion.headers);
+			if (cache && cache->load(cacheKey, sdkInfo.headers))
+				Log::Info("Loaded sdk '{}' from the cache", sdkVersion.name);
+			else
+				addCompileJob(graph.add(CompileSDKJob { context, sdkVersion, sdkInfo.headers, token, cache.get(), cacheKey }, JobSystem::EJobPriority::Normal, sdkInfo.version, token));
+		}
+
+		if (i < sdkVersions.size())
+		{
+			// Removers are cheap and release the newer SDK's duplicates early
+			auto removerJob = graph.add(RemoverJob { &sdkInfos[i], &sdkInfo }, JobSystem::EJobPriority::High, "Remove " + sdkInfos[i].version, token);
+			for (auto ref : refs)
+				graph.addEdge(ref, removerJob);
+			refs.erase(refs.begin(), refs.begin() + newerRefs);
+			allJobs.emplace_back(removerJob);
+		}
+	}
+
+	auto postProcessJob = graph.add(PostProcessJob { &sdkInfos }, JobSystem::EJobPriority::High, "PostProcess", token);
+	for (auto job : allJobs)
+		graph.addEdge(job, postProcessJob);
+	auto jobs = jobSystem.submit(std::move(graph));
+	Log::Info("Readied all compile jobs");
+	co_await jobs[postProcessJob];
+	// The token also catches failures that finished before we started waiting
+	if (token.cancelled())
+		throw Utils::Exception("JobSystem", "Regenerating the spec failed, not writing 'spec.xml'");
+
+	std::ofstream output { "spec.xml" };
+	if (!output)
+	{
+		Log::Critical("Failed to open 'spec.xml'");
+		co_return;
+	}
+
+	Serialization::XMLDocument document;
+	document.root.tag = "root";
+	Serialization::XMLSerialiaze(sdkInfos, document.root);
+	std::string str = Serialization::XMLToString(document, &jobSystem);
+	output.write(str.c_str(), str.size());
+	output.close();
+	Log::Info("Serialized output!");
+}
+
+// Introspects every header of the newest sdk with both profiles and logs how long each took, nothing is written
+// Headers are parsed without the precompiled prelude, so the system headers every one of them includes are part of the measurement
+static JobSystem::Task<> BenchmarkParse(JobSystem::JobSystem& jobSystem)
+{
+	using Clock = std::chrono::steady_clock;
+
+	auto sdkVersions = LocateAvailableSDKVersions("./");
+	if (sdkVersions.empty())
+	{
+		Log::Critical("Found no sdk to benchmark");
+		co_return;
+	}
+
+	auto&      sdkVersion = sdkVersions.back();
+	SDKContext context;
+	InitSDKContext(context, sdkVersion);
+	Log::Info("Benchmarking {} headers of '{}'", sdkVersion.headers.size(), sdkVersion.name);
+
+	double totalFull = 0.0;
+	double totalFast = 0.0;
+	for (auto& header : sdkVersion.headers)
+	{
+		// The better of two alternating runs per profile, so neither gets all the cold file reads
+		double times[2] { std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+		bool   failed = false;
+		for (std::size_t run = 0; run < 4 && !failed; ++run)
+		{
+			auto profile = run % 2 == 0 ? ClangIntrospection::EIntrospectionProfile::Full : ClangIntrospection::EIntrospectionProfile::Fast;
+
+			SDKInfo::Header headerInfo {};
+			headerInfo.name = std::filesystem::relative(header, sdkVersion.path).string();
+			auto start      = Clock::now();
+			failed          = !ClangIntrospection::Introspect(context.args, header, &headerInfo, jobSystem, {}, nullptr, &context.fileSystem, profile);
+			times[run % 2]  = std::min(times[run % 2], std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		}
+		if (failed)
+		{
+			Log::Warn("Failed to introspect header '{}', leaving it out", header.string());
+			continue;
+		}
+
+		totalFull += times[0];
+		totalFast += times[1];
+		Log::Info("'{}': full {:.1f} ms, fast {:.1f} ms, {:.1f}% less", header.string(), times[0], times[1], 100.0 - times[1] * 100.0 / times[0]);
+	}
+	if (totalFull > 0.0)
+		Log::Info("All headers: full {:.1f} ms, fast {:.1f} ms, {:.1f}% less", totalFull, totalFast, 100.0 - totalFast * 100.0 / totalFull);
+}
+
+int safeMain(int argc, const char** argv)
+{
+	Options options = ParseOptions(argc, argv);
+	if (!options.workerInput.empty())
+		return ClangIntrospection::RunIntrospectionWorker(options.workerInput, options.workerOutput, options.threadCount);
+
+	JobSystem::JobCostModel costModel;
+	if (options.criticalPath && !costModel.load("jobcosts.txt"))
+		Log::Info("No job costs from a previous run, critical paths will be estimated from this run");
+	JobSystem::JobSystem jobSystem { options.threadCount, options.pinThreads, options.criticalPath ? &costModel : nullptr };
+	Log::Info("Running with {} workers", jobSystem.threadCount());
+	if (!options.tracePath.empty())
+		jobSystem.startTracing();
+
+	auto task = options.benchmark ? BenchmarkParse(jobSystem) : RegenerateSpec(jobSystem, options);
+	jobSystem.waitForJob(JobSystem::Spawn(jobSystem, task, {}, JobSystem::EJobPriority::High));
+	task.result();
+	Log::Info("Job system stats:\n{}", jobSystem.stats());
+
+	if (!options.tracePath.empty())
 	{
-		auto lastJob = jobSystem.createJob(
-		    [&sdkInfos](JobSystem::JobRef currentJob)
-		    {
-			    std::ofstream output { "spec.xml" };
-			    if (!output)
-			    {
-				    Log::Critical("Failed to open 'spec.xml'");
-				    return;
-			    }
-
-			    Serialization::XMLDocument document;
-			    document.root.tag = "root";
-			    Serialization::XMLSerialiaze(sdkInfos, document.root);
-			    std::string str = Serialization::XMLToString(document);
-			    output.write(str.c_str(), str.size());
-			    output.close();
-			    Log::Info("Serialized output!");
-		    },
-		    { preProcessJob });
-
-		jobSystem.waitForJob(lastJob);
+		jobSystem.kill();
+		if (jobSystem.writeTrace(options.tracePath))
+			Log::Info("Wrote job trace to '{}'", options.tracePath.string());
+		else
+			Log::Warn("Failed to write job trace to '{}'", options.tracePath.string());
 	}
 
+	if (options.criticalPath && !costModel.save("jobcosts.txt"))
+		Log::Warn("Failed to save job costs to 'jobcosts.txt'");
+
 	return 0;
 }
 
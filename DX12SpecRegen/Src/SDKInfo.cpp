@@ -1,4 +1,5 @@
 #include "SDKInfo.h"
+#include "JobSystem/Parallel.h"
 
 #include <spdlog/fmt/fmt.h>
 
@@ -683,18 +684,24 @@ namespace SDKInfo
 		}
 	}
 
-	void RemovePreviousSDK(SDK& newer, SDK& older)
+	void RemovePreviousSDK(SDK& newer, SDK& older, JobSystem::JobSystem& jobSystem)
 	{
-		for (auto& header : newer.headers)
-		{
-			auto previousHeader = older.getHeader(header.name);
-			if (!previousHeader)
-			{
-				// New header
-				continue;
-			}
-
-			RemovePreviousHeader(header, *previousHeader);
-		}
+		// Every header only touches itself and its previous version, so they are independent
+		JobSystem::ParallelFor(
+		    jobSystem,
+		    0,
+		    newer.headers.size(),
+		    [&](std::size_t i)
+		    {
+			    auto& header         = newer.headers[i];
+			    auto  previousHeader = older.getHeader(header.name);
+			    if (!previousHeader)
+			    {
+				    // New header
+				    return;
+			    }
+
+			    RemovePreviousHeader(header, *previousHeader);
+		    });
 	}
 } // namespace SDKInfo
\ No newline at end of file
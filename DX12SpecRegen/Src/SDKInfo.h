@@ -5,6 +5,11 @@
 #include <string>
 #include <vector>
 
+namespace JobSystem
+{
+	class JobSystem;
+}
+
 namespace SDKInfo
 {
 	struct Constant
@@ -75,6 +80,8 @@ namespace SDKInfo
 		        Serialization::FieldInfo<"name", &Ordinal::name>,
 		        Serialization::FieldInfo<"altered", &Ordinal::altered, Serialization::PropertyInfo<Serialization::EInline::None, false>>,
 		        Serialization::FieldInfo<"value", &Ordinal::value, Serialization::PropertyInfo<Serialization::EInline::None, nullptr, CustomOptionsFiller>>>>;
+		using BinaryFields = Serialization::FieldInfos<
+		    Serialization::FieldInfo<"type", &Ordinal::type>>;
 	};
 
 	struct Flag
@@ -112,6 +119,8 @@ namespace SDKInfo
 		        Serialization::FieldInfo<"name", &Flag::name>,
 		        Serialization::FieldInfo<"altered", &Flag::altered, Serialization::PropertyInfo<Serialization::EInline::None, false>>,
 		        Serialization::FieldInfo<"value", &Flag::value, Serialization::PropertyInfo<Serialization::EInline::None, nullptr, CustomOptionsFiller>>>>;
+		using BinaryFields = Serialization::FieldInfos<
+		    Serialization::FieldInfo<"type", &Flag::type>>;
 	};
 
 	struct Enum
@@ -250,6 +259,8 @@ namespace SDKInfo
 		    Serialization::FieldInfos<
 		        Serialization::FieldInfo<"lang", &Impl::lang>,
 		        Serialization::FieldInfo<"code", &Impl::code>>>;
+		using BinaryFields = Serialization::FieldInfos<
+		    Serialization::FieldInfo<"has", &Impl::has>>;
 	};
 
 	struct Arg
@@ -475,5 +486,6 @@ namespace SDKInfo
 	void RemovePreviousStruct(Struct& newer, Struct& older);
 	void RemovePreviousCInterface(CInterface& newer, CInterface& older);
 	void RemovePreviousHeader(Header& newer, Header& older);
-	void RemovePreviousSDK(SDK& newer, SDK& older);
+	// Headers are diffed in parallel on the job system
+	void RemovePreviousSDK(SDK& newer, SDK& older, JobSystem::JobSystem& jobSystem);
 } // namespace SDKInfo
\ No newline at end of file
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "Serialization.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace Serialization
+{
+	// StructInfo fields in declaration order followed by BinaryFields, without names or versioning, only meant for passing values between processes of the same build
+
+	template <class T>
+	struct BinarySerializer;
+
+	// Members the xml leaves out, a value doesn't survive the round trip without them
+	template <class T>
+	concept HasBinaryFields =
+	    requires {
+		    typename T::BinaryFields;
+	    };
+
+	template <class T>
+	concept BinaryScalar = std::is_integral_v<T> || std::is_enum_v<T>;
+
+	template <class T>
+	void BinarySerialize(const T& value, std::string& out)
+	{
+		using Serializer = BinarySerializer<T>;
+		Serializer serializer {};
+		serializer.Serialize(value, out);
+	}
+
+	// Consumes the value from the front of in, false if in ended early
+	template <class T>
+	bool BinaryDeserialize(T& value, std::string_view& in)
+	{
+		using Serializer = BinarySerializer<T>;
+		Serializer serializer {};
+		return serializer.Deserialize(value, in);
+	}
+
+	// Describes the layout BinarySerialize writes for T, values only read back under the same schema
+	template <class T>
+	std::string BinarySchema()
+	{
+		std::string schema;
+		BinarySerializer<T>::Schema(schema);
+		return schema;
+	}
+
+	template <Serializable T>
+	struct BinarySerializer<T>
+	{
+	public:
+		using StructInfo = typename T::StructInfo;
+
+	public:
+		template <class... TFieldInfos>
+		void SerializeFields(const T& value, std::string& out, Detail::Tuple<TFieldInfos...>)
+		{
+			(BinarySerialize(TFieldInfos::Get(value), out), ...);
+		}
+
+		template <class... TFieldInfos>
+		bool DeserializeFields(T& value, std::string_view& in, Detail::Tuple<TFieldInfos...>)
+		{
+			return (BinaryDeserialize(TFieldInfos::Get(value), in) && ...);
+		}
+
+		template <class... TFieldInfos>
+		static void SchemaFields(std::string& out, Detail::Tuple<TFieldInfos...>)
+		{
+			((out += std::string_view { TFieldInfos::Name }, out += ':', BinarySerializer<typename TFieldInfos::Type>::Schema(out), out += ';'), ...);
+		}
+
+		void Serialize(const T& value, std::string& out)
+		{
+			SerializeFields(value, out, typename StructInfo::Fields {});
+			if constexpr (HasBinaryFields<T>)
+				SerializeFields(value, out, typename T::BinaryFields::Fields {});
+		}
+
+		bool Deserialize(T& value, std::string_view& in)
+		{
+			if (!DeserializeFields(value, in, typename StructInfo::Fields {}))
+				return false;
+			if constexpr (HasBinaryFields<T>)
+				return DeserializeFields(value, in, typename T::BinaryFields::Fields {});
+			return true;
+		}
+
+		static void Schema(std::string& out)
+		{
+			out += std::string_view { StructInfo::Name };
+			out += '{';
+			SchemaFields(out, typename StructInfo::Fields {});
+			if constexpr (HasBinaryFields<T>)
+				SchemaFields(out, typename T::BinaryFields::Fields {});
+			out += '}';
+		}
+	};
+
+	template <BinaryScalar T>
+	struct BinarySerializer<T>
+	{
+	public:
+		void Serialize(T value, std::string& out)
+		{
+			out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		bool Deserialize(T& value, std::string_view& in)
+		{
+			if (in.size() < sizeof(T))
+				return false;
+			std::memcpy(&value, in.data(), sizeof(T));
+			in.remove_prefix(sizeof(T));
+			return true;
+		}
+
+		static void Schema(std::string& out)
+		{
+			out += std::is_enum_v<T> ? 'e' : 'i';
+			out += std::to_string(sizeof(T));
+		}
+	};
+
+	template <>
+	struct BinarySerializer<std::string>
+	{
+	public:
+		void Serialize(const std::string& value, std::string& out)
+		{
+			BinarySerialize(static_cast<std::uint64_t>(value.size()), out);
+			out += value;
+		}
+
+		bool Deserialize(std::string& value, std::string_view& in)
+		{
+			std::uint64_t size = 0;
+			if (!BinaryDeserialize(size, in) || in.size() < size)
+				return false;
+			value.assign(in.substr(0, size));
+			in.remove_prefix(size);
+			return true;
+		}
+
+		static void Schema(std::string& out)
+		{
+			out += 's';
+		}
+	};
+
+	template <class T, class Alloc>
+	struct BinarySerializer<std::vector<T, Alloc>>
+	{
+	public:
+		void Serialize(const std::vector<T, Alloc>& value, std::string& out)
+		{
+			BinarySerialize(static_cast<std::uint64_t>(value.size()), out);
+			for (auto& val : value)
+				BinarySerialize(val, out);
+		}
+
+		bool Deserialize(std::vector<T, Alloc>& value, std::string_view& in)
+		{
+			std::uint64_t size = 0;
+			if (!BinaryDeserialize(size, in))
+				return false;
+			value.clear();
+			// Every element takes at least a byte, so a corrupt count can't reserve more than is left
+			value.reserve(std::min<std::uint64_t>(size, in.size()));
+			for (std::uint64_t i = 0; i < size; ++i)
+				if (!BinaryDeserialize(value.emplace_back(), in))
+					return false;
+			return true;
+		}
+
+		static void Schema(std::string& out)
+		{
+			out += 'v';
+			BinarySerializer<T>::Schema(out);
+		}
+	};
+} // namespace Serialization
\ No newline at end of file
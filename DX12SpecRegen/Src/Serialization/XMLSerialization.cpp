@@ -1,4 +1,5 @@
 #include "XMLSerialization.h"
+#include "JobSystem/Parallel.h"
 #include "Utils/Unicode.h"
 
 #include <spdlog/fmt/fmt.h>
@@ -186,7 +187,10 @@ namespace Serialization
 		return nullptr;
 	}
 
-	std::string XMLToString(const XMLElement& element, std::size_t indent)
+	// Deeper elements are too small to be worth a job each
+	static constexpr std::size_t c_ParallelXMLDepth = 3;
+
+	std::string XMLToString(const XMLElement& element, std::size_t indent, JobSystem::JobSystem* jobSystem)
 	{
 		if (element.children.empty() && element.attributes.empty())
 			return "";
@@ -201,19 +205,30 @@ namespace Serialization
 			return fmt::format("{}<{}{}/>", indentStr, XMLEncode(element.tag), attributesStr);
 
 		std::string str = fmt::format("{}<{}{}>", indentStr, XMLEncode(element.tag), attributesStr);
-		for (auto& child : element.children)
+		if (jobSystem && indent < c_ParallelXMLDepth)
+		{
+			std::pmr::vector<std::string> childStrs(element.children.size(), jobSystem->scratch());
+			JobSystem::ParallelFor(*jobSystem, 0, element.children.size(), [&](std::size_t i) { childStrs[i] = XMLToString(element.children[i], indent + 1, jobSystem); });
+			for (auto& childStr : childStrs)
+				if (!childStr.empty())
+					str += fmt::format("\n{}", childStr);
+		}
+		else
 		{
-			std::string childStr = XMLToString(child, indent + 1);
-			if (!childStr.empty())
-				str += fmt::format("\n{}", childStr);
+			for (auto& child : element.children)
+			{
+				std::string childStr = XMLToString(child, indent + 1);
+				if (!childStr.empty())
+					str += fmt::format("\n{}", childStr);
+			}
 		}
 		return str += fmt::format("\n{}</{}>", indentStr, XMLEncode(element.tag));
 	}
 
-	std::string XMLToString(const XMLDocument& document)
+	std::string XMLToString(const XMLDocument& document, JobSystem::JobSystem* jobSystem)
 	{
 		std::string str = fmt::format("<?xml version=\"{}\" encoding=\"{}\"?>\n", document.version, document.encoding);
-		return str += XMLToString(document.root);
+		return str += XMLToString(document.root, 0, jobSystem);
 	}
 
 	static std::size_t SkipSpaces(std::string_view& str)
@@ -4,6 +4,11 @@
 
 #include <spdlog/fmt/fmt.h>
 
+namespace JobSystem
+{
+	class JobSystem;
+}
+
 namespace Serialization
 {
 	struct XMLAttribute
@@ -35,8 +40,9 @@ namespace Serialization
 		XMLElement  root;
 	};
 
-	std::string XMLToString(const XMLElement& element, std::size_t indent = 0);
-	std::string XMLToString(const XMLDocument& document);
+	// With a job system the children of the upper levels are converted in parallel
+	std::string XMLToString(const XMLElement& element, std::size_t indent = 0, JobSystem::JobSystem* jobSystem = nullptr);
+	std::string XMLToString(const XMLDocument& document, JobSystem::JobSystem* jobSystem = nullptr);
 	XMLDocument StringToXML(std::string_view str);
 
 	template <class T>
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Utils
+{
+	template <class Signature, std::size_t Capacity>
+	class InplaceFunction;
+
+	// Move-only std::function replacement that always stores the callable inline, callables larger than Capacity fail to compile instead of allocating
+	template <class R, class... Args, std::size_t Capacity>
+	class InplaceFunction<R(Args...), Capacity>
+	{
+	public:
+		InplaceFunction() : m_VTable(nullptr) {}
+		InplaceFunction(std::nullptr_t) : m_VTable(nullptr) {}
+		template <class F>
+		requires(!std::is_same_v<std::remove_cvref_t<F>, InplaceFunction> && std::is_invocable_r_v<R, std::decay_t<F>&, Args...>)
+		InplaceFunction(F&& func)
+		{
+			using Functor = std::decay_t<F>;
+			static_assert(sizeof(Functor) <= Capacity, "Callable does not fit in InplaceFunction, capture less or increase the capacity");
+			static_assert(alignof(Functor) <= alignof(std::max_align_t), "Callable is over aligned");
+			static_assert(std::is_move_constructible_v<Functor>, "Callable has to be move constructible");
+
+			new (m_Storage) Functor(std::forward<F>(func));
+			m_VTable = &s_VTable<Functor>;
+		}
+		InplaceFunction(InplaceFunction&& move) noexcept
+		    : m_VTable(move.m_VTable)
+		{
+			if (m_VTable)
+			{
+				m_VTable->move(m_Storage, move.m_Storage);
+				move.m_VTable = nullptr;
+			}
+		}
+		InplaceFunction(const InplaceFunction&) = delete;
+		~InplaceFunction() { reset(); }
+
+		InplaceFunction& operator=(InplaceFunction&& move) noexcept
+		{
+			if (this == &move)
+				return *this;
+
+			reset();
+			m_VTable = move.m_VTable;
+			if (m_VTable)
+			{
+				m_VTable->move(m_Storage, move.m_Storage);
+				move.m_VTable = nullptr;
+			}
+			return *this;
+		}
+		InplaceFunction& operator=(const InplaceFunction&) = delete;
+		InplaceFunction& operator=(std::nullptr_t)
+		{
+			reset();
+			return *this;
+		}
+
+		R operator()(Args... args) { return m_VTable->invoke(m_Storage, std::forward<Args>(args)...); }
+
+		explicit operator bool() const { return m_VTable != nullptr; }
+
+		void reset()
+		{
+			if (m_VTable)
+			{
+				m_VTable->destroy(m_Storage);
+				m_VTable = nullptr;
+			}
+		}
+
+	private:
+		struct VTable
+		{
+		public:
+			R (*invoke)(void* storage, Args&&... args);
+			void (*move)(void* destination, void* source);
+			void (*destroy)(void* storage);
+		};
+
+		template <class Functor>
+		static constexpr VTable s_VTable = {
+			[](void* storage, Args&&... args) -> R
+			{
+				return (*static_cast<Functor*>(storage))(std::forward<Args>(args)...);
+			},
+			[](void* destination, void* source)
+			{
+				new (destination) Functor(std::move(*static_cast<Functor*>(source)));
+				static_cast<Functor*>(source)->~Functor();
+			},
+			[](void* storage)
+			{
+				static_cast<Functor*>(storage)->~Functor();
+			}
+		};
+
+	private:
+		alignas(std::max_align_t) std::byte m_Storage[Capacity];
+		const VTable* m_VTable;
+	};
+} // namespace Utils
\ No newline at end of file